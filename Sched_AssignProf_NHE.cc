@@ -3,27 +3,120 @@
 
 namespace
 {
-  // Help function: for the selected class gets the professor of the subjects not completly assigned
-  //                if a subject doesn't have assigned hours gets all the profs teaching that subject
-  vector<unsigned> GetAvailableProfs(const Sched_Input& in, const Sched_Output& out, const int c)
+  // Help function: sets the move prof to the first candidate professor of the class, starting from subject s
+  //                (the candidates of a subject are its class' prof if it has assigned hours, otherwise all the profs teaching that subject)
+  bool FirstCandidateProf(const Sched_Input& in, const Sched_Output& out, Sched_AssignProf& mv, unsigned s)
   {
-    unsigned s, p;
-    vector<unsigned> available_profs;
+    uint64_t open_subjects = s < 64 ? out.ClassOpenSubjects(mv._class) & (~(uint64_t)0 << s) : 0;
 
-    available_profs.clear();
-    
-    for (s = 0; s < in.N_Subjects(); s++)
+    if (open_subjects == 0)
+      return false;
+
+    s = countr_zero(open_subjects);
+
+    mv.index = 0;
+    if (out.WeeklySubjectAssignedHours(mv._class, s) > 0)
+      mv.prof = out.Subject_Prof(mv._class, s);
+    else
+      mv.prof = in.SubjectProf(s, 0);
+
+    return true;
+  }
+
+  // Help function: sets the move prof to the candidate professor following the current one
+  //                NOTE: mv.index is the position of the prof among the profs of his subject
+  bool NextCandidateProf(const Sched_Input& in, const Sched_Output& out, Sched_AssignProf& mv)
+  {
+    unsigned s = in.ProfSubject(mv.prof);
+
+    if (out.WeeklySubjectAssignedHours(mv._class, s) == 0 && mv.index < (int)in.N_ProfsXSubject(s) - 1)
+    {
+      mv.index++;
+      mv.prof = in.SubjectProf(s, mv.index);
+      return true;
+    }
+
+    return FirstCandidateProf(in, out, mv, s + 1);
+  }
+
+  // Help function: sets the move prof to the i-th candidate professor of the class
+  void SelectCandidateProf(const Sched_Input& in, const Sched_Output& out, Sched_AssignProf& mv, unsigned i)
+  {
+    unsigned s;
+    uint64_t open_subjects = out.ClassOpenSubjects(mv._class);
+
+    while (open_subjects != 0)
+    {
+      s = countr_zero(open_subjects);
+      open_subjects &= open_subjects - 1;
+
+      if (out.WeeklySubjectAssignedHours(mv._class, s) > 0)
+      {
+        if (i == 0)
+        {
+          mv.index = 0;
+          mv.prof = out.Subject_Prof(mv._class, s);
+          return;
+        }
+        i--;
+      }
+      else
+      {
+        if (i < in.N_ProfsXSubject(s))
+        {
+          mv.index = i;
+          mv.prof = in.SubjectProf(s, i);
+          return;
+        }
+        i -= in.N_ProfsXSubject(s);
+      }
+    }
+  }
+
+  // Help function: true if some open class has a free hour in common with one of its candidate professors
+  //                (otherwise the neighborhood is empty even if there are hours to assign)
+  bool AnyFeasibleMove(const Sched_Input& in, const Sched_Output& out)
+  {
+    unsigned i, c, s, k;
+    uint64_t free_hours, open_subjects;
+
+    for (i = 0; i < out.N_OpenClasses(); i++)
     {
-      if (out.WeeklySubjectResidualHours(c, s) > 0)
+      c = out.OpenClass(i);
+      free_hours = ~out.ClassMask(c) & out.WeekMask();
+      open_subjects = out.ClassOpenSubjects(c);
+
+      while (open_subjects != 0)
       {
+        s = countr_zero(open_subjects);
+        open_subjects &= open_subjects - 1;
+
         if (out.WeeklySubjectAssignedHours(c, s) > 0)
-          available_profs.push_back(out.Subject_Prof(c, s));
+        {
+          if ((free_hours & ~out.ProfMask(out.Subject_Prof(c, s))) != 0)
+            return true;
+        }
         else
-          for (p = 0; p < in.N_ProfsXSubject(s); p++)
-            available_profs.push_back(in.SubjectProf(s, p));
+          for (k = 0; k < in.N_ProfsXSubject(s); k++)
+            if ((free_hours & ~out.ProfMask(in.SubjectProf(s, k))) != 0)
+              return true;
       }
     }
-    return available_profs;
+
+    return false;
+  }
+
+  // Help function: moves to the first free hour of the class starting from the current one (included)
+  bool FirstFreeHour(const Sched_Input& in, const Sched_Output& out, Sched_AssignProf& mv)
+  {
+    uint64_t free_hours = ~out.ClassMask(mv._class) & out.WeekMask() & (~(uint64_t)0 << out.Slot(mv.day, mv.hour));
+
+    if (free_hours == 0)
+      return false;
+
+    mv.day = countr_zero(free_hours) / in.N_HoursXDay();
+    mv.hour = countr_zero(free_hours) % in.N_HoursXDay();
+    return true;
   }
 }
 
@@ -79,30 +172,23 @@ ostream& operator<<(ostream& os, const Sched_AssignProf& mv)
 
 void Sched_AssignProf_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sched_AssignProf& mv) const
 {
-  unsigned c;
-  vector<unsigned> available_profs;
-  vector<unsigned> class_with_moves;
+  SCHED_PROFILE(ASSIGN_PROF, RANDOM_MOVE);
+
   unsigned max_iterations = 1000000;
   unsigned iterations = 0;
 
-  for (c = 0; c < in.N_Classes(); c++)
-    if (GetAvailableProfs(in, out, c).size() > 0)
-      class_with_moves.push_back(c);
-
-  if (class_with_moves.size() == 0)
+  // The rejection loop below would spin until max_iterations on an empty neighborhood
+  if (out.N_OpenClasses() == 0 || !AnyFeasibleMove(in, out))
     throw EmptyNeighborhood();
 
   do
   {
-    mv._class = class_with_moves[Random::Uniform<int>(0, class_with_moves.size()-1)];
+    // Get a class with not all hours already assigned, and one of its candidate profs
+    mv._class = out.OpenClass(Sched_Random::Uniform<int>(0, out.N_OpenClasses()-1));
 
-    // Get all profs of the class with not all hours already assigned
-    available_profs.clear();
-    available_profs = GetAvailableProfs(in, out, mv._class);
-
-    mv.day = Random::Uniform<int>(0, in.N_Days()-1);
-    mv.hour = Random::Uniform<int>(0, in.N_HoursXDay()-1);
-    mv.prof = available_profs[Random::Uniform<int>(0, available_profs.size()-1)];
+    mv.day = Sched_Random::Uniform<int>(0, in.N_Days()-1);
+    mv.hour = Sched_Random::Uniform<int>(0, in.N_HoursXDay()-1);
+    SelectCandidateProf(in, out, mv, Sched_Random::Uniform<int>(0, out.ClassCandidateProfs(mv._class)-1));
 
     iterations++;
     if (iterations > max_iterations)
@@ -113,35 +199,37 @@ void Sched_AssignProf_NeighborhoodExplorer::RandomMove(const Sched_Output& out,
 
 bool Sched_AssignProf_NeighborhoodExplorer::FeasibleMove(const Sched_Output& out, const Sched_AssignProf& mv) const
 {
+  SCHED_PROFILE(ASSIGN_PROF, FEASIBLE_MOVE);
+
   // If both Class and Prof are free
-  return out.IsClassHourFree(mv._class, mv.day, mv.hour) && out.IsProfHourFree(mv.prof, mv.day, mv.hour);
+  SCHED_PROFILE_RETURN(out.IsClassHourFree(mv._class, mv.day, mv.hour) && out.IsProfHourFree(mv.prof, mv.day, mv.hour));
 } 
 
 void Sched_AssignProf_NeighborhoodExplorer::MakeMove(Sched_Output& out, const Sched_AssignProf& mv) const
 {
+  SCHED_PROFILE(ASSIGN_PROF, MAKE_MOVE);
+
   out.AssignHour(mv._class, mv.day, mv.hour, mv.prof);
 }
 
 void Sched_AssignProf_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sched_AssignProf& mv) const
 {
-  unsigned c;
-  vector<unsigned> available_profs;
+  SCHED_PROFILE(ASSIGN_PROF, FIRST_MOVE);
 
-  for (c = 0; c < in.N_Classes(); c++)
-    if (GetAvailableProfs(in, out, c).size() > 0)
-      break;
+  mv._class = 0;
+  mv.day = 0;
+  mv.hour = 0;
 
-  if (c == in.N_Classes())  // There are no moves
-    throw EmptyNeighborhood();
-  
-  mv._class = c;
+  // Classes without candidate profs or free hours have no moves
+  while (out.ClassCandidateProfs(mv._class) == 0 || !FirstFreeHour(in, out, mv))
+  {
+    mv._class++;
 
-  available_profs = GetAvailableProfs(in, out, mv._class);
+    if (mv._class == in.N_Classes())  // There are no moves
+      throw EmptyNeighborhood();
+  }
 
-  mv.day = 0;
-  mv.hour = 0;
-  mv.index = 0;
-  mv.prof = available_profs[mv.index];
+  FirstCandidateProf(in, out, mv, 0);
 
   while (!FeasibleMove(out, mv))
     if (!AnyNextMove(out, mv))
@@ -150,6 +238,8 @@ void Sched_AssignProf_NeighborhoodExplorer::FirstMove(const Sched_Output& out, S
 
 bool Sched_AssignProf_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sched_AssignProf& mv) const
 {
+  SCHED_PROFILE(ASSIGN_PROF, NEXT_MOVE);
+
   do
   {
     if (!AnyNextMove(out,mv))
@@ -160,55 +250,67 @@ bool Sched_AssignProf_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sc
   return true;
 }
 
-bool Sched_AssignProf_NeighborhoodExplorer::AnyNextMove(const Sched_Output& out, Sched_AssignProf& mv) const
+bool Sched_AssignProf_NeighborhoodExplorer::FirstMoveInBlock(const Sched_Output& out, Sched_AssignProf& mv, unsigned b) const
 {
-  vector<unsigned> available_profs;
+  SCHED_PROFILE(ASSIGN_PROF, FIRST_MOVE_IN_BLOCK);
 
-  available_profs = GetAvailableProfs(in, out, mv._class);
+  mv._class = b;
+  mv.day = 0;
+  mv.hour = 0;
 
-  while (available_profs.size() == 0)
-  {
-    mv._class++;
+  if (out.ClassCandidateProfs(mv._class) == 0 || !FirstFreeHour(in, out, mv))
+    return false;
 
-    if (mv._class == in.N_Classes())
+  FirstCandidateProf(in, out, mv, 0);
+
+  while (!FeasibleMove(out, mv))
+    if (!AnyNextMove(out, mv) || mv._class != (int)b)
       return false;
 
-    mv.index = -1;
-    available_profs.clear();
-    available_profs = GetAvailableProfs(in, out, mv._class);
-  }
+  return true;
+}
+
+bool Sched_AssignProf_NeighborhoodExplorer::NextMoveInBlock(const Sched_Output& out, Sched_AssignProf& mv) const
+{
+  SCHED_PROFILE(ASSIGN_PROF, NEXT_MOVE_IN_BLOCK);
+
+  int b = mv._class;
 
-  if (mv.index < available_profs.size() - 1)
-    mv.index++;
-  else
+  do
   {
-    mv.hour++;
-    mv.index = 0;
+    if (!AnyNextMove(out, mv) || mv._class != b)
+      return false;
+  }
+  while (!FeasibleMove(out, mv));
 
-    if (mv.hour == in.N_HoursXDay())
-    {
-      mv.day++;
-      mv.hour = 0;
+  return true;
+}
 
-      if (mv.day == in.N_Days())
-      {
-        do
-        {
-          mv._class++;
+bool Sched_AssignProf_NeighborhoodExplorer::AnyNextMove(const Sched_Output& out, Sched_AssignProf& mv) const
+{
+  if (NextCandidateProf(in, out, mv))
+    return true;
 
-          if (mv._class == in.N_Classes())
-            return false;
-        
-          available_profs.clear();
-          available_profs = GetAvailableProfs(in, out, mv._class);
-        } while (available_profs.size() == 0);
+  // Candidate profs are finished: move to the next free hour of the class...
+  mv.hour++;
 
-        mv.day = 0;
-      }
-    }
+  if (mv.hour == in.N_HoursXDay())
+  {
+    mv.day++;
+    mv.hour = 0;
   }
 
-  mv.prof = available_profs[mv.index];
+  // ...or to the next class with candidate profs and free hours
+  while (mv.day == in.N_Days() || out.ClassCandidateProfs(mv._class) == 0 || !FirstFreeHour(in, out, mv))
+  {
+    mv._class++;
 
-  return true;
-}
\ No newline at end of file
+    if (mv._class == in.N_Classes())
+      return false;
+
+    mv.day = 0;
+    mv.hour = 0;
+  }
+
+  return FirstCandidateProf(in, out, mv, 0);
+}
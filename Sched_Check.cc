@@ -0,0 +1,441 @@
+// File Sched_Check.cc
+// Consistency checks of the incremental data structures (make check): sched_check <instance files>
+// Every check compares the fast path with a full recomputation, prints its outcome for each instance, and the
+// program returns 1 if any of them fails
+#include "Sched_Headers.hh"
+#include <filesystem>
+#include <sstream>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace
+{
+  const unsigned moves_per_neighborhood = 2000;
+  const unsigned states_per_check = 4;
+  const unsigned kempe_swap_sampling = 10;
+
+  // Help function: prints the outcome of a check, true if it passed
+  bool Report(const string& check, const string& instance, unsigned long cases, unsigned long failures)
+  {
+    cout << check << " (" << instance << "): ";
+    if (failures == 0)
+      cout << "OK, " << cases << " cases" << endl;
+    else
+      cout << "FAILED, " << failures << " of " << cases << " cases" << endl;
+    return failures == 0;
+  }
+
+  // Help function: the state rebuilt by replaying the class schedule of out on an empty one
+  void Rebuild(const Sched_Input& in, const Sched_Output& out, Sched_Output& rebuilt)
+  {
+    unsigned c, d, h;
+
+    rebuilt.Reset();
+    for (c = 0; c < in.N_Classes(); c++)
+      for (d = 0; d < in.N_Days(); d++)
+        for (h = 0; h < in.N_HoursXDay(); h++)
+          if (!out.IsClassHourFree(c, d, h))
+            rebuilt.AssignHour(c, d, h, out.Class_Schedule(c, d, h));
+  }
+
+  // Help function: frees n random class hours, so that the state has moves of AssignProf as well
+  void FreeRandomHours(const Sched_Input& in, Sched_Output& out, unsigned n)
+  {
+    unsigned i, c, d, h;
+
+    for (i = 0; i < n; i++)
+    {
+      c = Random::Uniform<unsigned>(0, in.N_Classes() - 1);
+      d = Random::Uniform<unsigned>(0, in.N_Days() - 1);
+      h = Random::Uniform<unsigned>(0, in.N_HoursXDay() - 1);
+      if (!out.IsClassHourFree(c, d, h))
+        out.FreeHour(c, d, h);
+    }
+  }
+
+  // Help function: true if delta is the difference of the full costs, component by component
+  bool SameDelta(const DefaultCostStructure<int>& before, const DefaultCostStructure<int>& after, const DefaultCostStructure<int>& delta)
+  {
+    unsigned i;
+
+    if (after.total - before.total != delta.total || after.violations - before.violations != delta.violations || after.objective - before.objective != delta.objective)
+      return false;
+    for (i = 0; i < delta.all_components.size(); i++)
+      if (after.all_components[i] - before.all_components[i] != delta.all_components[i])
+        return false;
+    return true;
+  }
+
+  // Random moves of a neighborhood along a chain of states: the delta of each move must be the difference of the
+  // full costs, and the incremental tables and violation totals of the state after the move (e.g. the professor
+  // tables relabeled by SwapSubjectProfs) the ones rebuilt from its class schedule
+  template <class NHE, class Move>
+  bool CheckMoves(const Sched_Input& in, const string& instance, Sched_SolutionManager& sm, const NHE& nhe, const string& name)
+  {
+    Sched_Output out(in), next(in), rebuilt(in);
+    DefaultCostStructure<int> cost, next_cost, delta;
+    Move mv;
+    unsigned i, failures = 0, cases = 0;
+
+    sm.RandomState(out);
+    FreeRandomHours(in, out, in.N_Classes());
+    cost = sm.CostFunctionComponents(out);
+
+    for (i = 0; i < moves_per_neighborhood; i++)
+    {
+      try
+      {
+        nhe.RandomMove(out, mv);
+      }
+      catch (EmptyNeighborhood&)
+      { // e.g. AssignProf on a complete schedule: more free hours
+        FreeRandomHours(in, out, in.N_Classes());
+        cost = sm.CostFunctionComponents(out);
+        continue;
+      }
+      delta = nhe.DeltaCostFunctionComponents(out, mv);
+      next = out;
+      nhe.MakeMove(next, mv);
+      next_cost = sm.CostFunctionComponents(next);
+      Rebuild(in, next, rebuilt);
+      cases++;
+
+      if (!SameDelta(cost, next_cost, delta) || !(rebuilt == next) || rebuilt.N_OpenClasses() != next.N_OpenClasses() || !sm.CheckConsistency(next))
+        failures++;
+
+      // The chain follows the improving moves and one in four of the others, so that it does not get stuck
+      if (delta.total <= 0 || Random::Uniform<int>(0, 3) == 0)
+      {
+        out = next;
+        cost = next_cost;
+      }
+    }
+
+    return Report(name + " moves", instance, cases, failures);
+  }
+
+  // Kempe chains of every class and pair of hours: the chain starts from its class, has no repetitions and is
+  // closed (the professors of its classes in either hour teach only chain classes in the other one), so swapping
+  // the two hours of its classes gives a state equal to the one rebuilt from the class schedule (checked on one
+  // chain in kempe_swap_sampling, the rebuild takes most of the time)
+  bool CheckKempeChains(const Sched_Input& in, const string& instance, Sched_SolutionManager& sm)
+  {
+    Sched_Output out(in), next(in), rebuilt(in);
+    vector<unsigned> classes;
+    vector<bool> in_chain(in.N_Classes());
+    unsigned r, c, k, slot_1, slot_2, d1, h1, d2, h2, i;
+    unsigned n_slots = in.N_Days() * in.N_HoursXDay();
+    unsigned long failures = 0, cases = 0;
+    bool closed;
+    int p, other_class;
+
+    for (r = 0; r < states_per_check; r++)
+    {
+      if (r % 2 == 0)
+        sm.RandomState(out);
+      else
+        sm.GreedyState(out);
+      FreeRandomHours(in, out, r * in.N_Classes());
+
+      for (c = 0; c < in.N_Classes(); c++)
+        for (slot_1 = 0; slot_1 < n_slots; slot_1++)
+          for (slot_2 = slot_1 + 1; slot_2 < n_slots; slot_2++)
+          {
+            d1 = slot_1 / in.N_HoursXDay();
+            h1 = slot_1 % in.N_HoursXDay();
+            d2 = slot_2 / in.N_HoursXDay();
+            h2 = slot_2 % in.N_HoursXDay();
+            out.KempeChain(c, d1, h1, d2, h2, classes);
+            cases++;
+
+            fill(in_chain.begin(), in_chain.end(), false);
+            closed = classes[0] == c;
+            for (i = 0; i < classes.size() && closed; i++)
+            {
+              closed = !in_chain[classes[i]];
+              in_chain[classes[i]] = true;
+            }
+            for (k = 0; k < classes.size() && closed; k++)
+            {
+              if ((p = out.Class_Schedule(classes[k], d1, h1)) != -1 && (other_class = out.Prof_Schedule(p, d2, h2)) != -1 && !in_chain[other_class])
+                closed = false;
+              if ((p = out.Class_Schedule(classes[k], d2, h2)) != -1 && (other_class = out.Prof_Schedule(p, d1, h1)) != -1 && !in_chain[other_class])
+                closed = false;
+            }
+            if (!closed)
+            {
+              failures++;
+              continue;
+            }
+            if (cases % kempe_swap_sampling != 0)
+              continue;
+
+            next = out;
+            next.SwapHoursInClasses(classes, d1, h1, d2, h2);
+            Rebuild(in, next, rebuilt);
+            if (!(rebuilt == next) || !sm.CheckConsistency(next))
+              failures++;
+          }
+    }
+
+    return Report("KempeChain closure", instance, cases, failures);
+  }
+
+  // Snapshots of random (also partial) states: the loaded state equals the saved one, in memory and through a file,
+  // and a truncated or corrupted snapshot is rejected
+  bool CheckSnapshots(const Sched_Input& in, const string& instance, Sched_SolutionManager& sm, const string& directory)
+  {
+    Sched_Output out(in), loaded(in);
+    string filename = directory + "/state.snp", data, bad;
+    unsigned r;
+    unsigned long failures = 0, cases = 0;
+
+    for (r = 0; r < states_per_check; r++)
+    {
+      if (r % 2 == 0)
+        sm.RandomState(out);
+      else
+        sm.GreedyState(out);
+      FreeRandomHours(in, out, r * in.N_Classes());
+
+      ostringstream os;
+      out.WriteSnapshot(os);
+      data = os.str();
+      {
+        ofstream file(filename, ios::binary);
+        file << data;
+      }
+
+      cases++;
+      loaded.LoadSnapshot(data.data(), data.size());
+      if (!(loaded == out) || loaded.N_OpenClasses() != out.N_OpenClasses())
+        failures++;
+
+      cases++;
+      loaded.Reset();
+      loaded.ReadSnapshot(filename);
+      if (!(loaded == out) || !Sched_Output::IsSnapshot(filename))
+        failures++;
+
+      cases++;
+      try
+      {
+        loaded.LoadSnapshot(data.data(), data.size() - 1);
+        failures++;
+      }
+      catch (const runtime_error&) {}
+
+      cases++;
+      bad = data;
+      bad[bad.size() / 2] ^= 1;
+      try
+      {
+        loaded.LoadSnapshot(bad.data(), bad.size());
+        failures++;
+      }
+      catch (const runtime_error&) {}
+    }
+
+    return Report("Snapshot round trip", instance, cases, failures);
+  }
+
+  // Help function: the text form of an instance, to compare two of them
+  string InstanceText(const Sched_Input& in)
+  {
+    ostringstream os;
+
+    os << in;
+    return os.str();
+  }
+
+  // Help function: replaces the text of a file, optionally keeping its modification time
+  void RewriteFile(const string& filename, const string& text, bool keep_time)
+  {
+    filesystem::file_time_type time;
+
+    if (keep_time)
+      time = filesystem::last_write_time(filename);
+    {
+      ofstream os(filename, ios::binary | ios::trunc);
+      os << text;
+    }
+    if (keep_time)
+      filesystem::last_write_time(filename, time);
+  }
+
+  // Compiled instance cache: it reads back the instance it has been compiled from, it is rebuilt when the text file
+  // changes size or modification time (and only then: it is keyed on them, not on the text), and a corrupted cache
+  // is parsed again
+  bool CheckInstanceCache(const string& input_filename, const string& instance, const string& directory)
+  {
+    string filename = directory + "/instance.txt", cache_filename = filename + ".schedbin", text, changed, cache, expected;
+    unsigned long failures = 0, cases = 0;
+    size_t position;
+
+    {
+      ifstream is(input_filename, ios::binary);
+      stringstream buffer;
+      buffer << is.rdbuf();
+      text = buffer.str();
+    }
+    RewriteFile(filename, text, false);
+    remove(cache_filename.c_str());
+    expected = InstanceText(Sched_Input(filename));
+
+    // Compiled at the first run, then read back
+    cases++;
+    if (InstanceText(Sched_Input(filename, true)) != expected || !filesystem::exists(cache_filename))
+      failures++;
+    cases++;
+    if (InstanceText(Sched_Input(filename, true)) != expected)
+      failures++;
+
+    // Same size and time: the cache is used, whatever the text
+    position = text.find("Days ") + 5;
+    changed = text;
+    changed[position] = changed[position] == '5' ? '6' : '5';
+    RewriteFile(filename, changed, true);
+    cases++;
+    if (InstanceText(Sched_Input(filename, true)) != expected)
+      failures++;
+
+    // Same size, a new time: rebuilt
+    RewriteFile(filename, changed, false);
+    filesystem::last_write_time(filename, filesystem::last_write_time(filename) + chrono::seconds(1));
+    cases++;
+    if (InstanceText(Sched_Input(filename, true)) != InstanceText(Sched_Input(filename)))
+      failures++;
+
+    // A new size, the same time: rebuilt
+    RewriteFile(filename, text + "\n", true);
+    cases++;
+    if (InstanceText(Sched_Input(filename, true)) != expected)
+      failures++;
+
+    // Corrupted cache: parsed again
+    {
+      ifstream is(cache_filename, ios::binary);
+      stringstream buffer;
+      buffer << is.rdbuf();
+      cache = buffer.str();
+    }
+    cache[cache.size() - 1] ^= 1;
+    RewriteFile(cache_filename, cache, true);
+    cases++;
+    if (InstanceText(Sched_Input(filename, true)) != expected)
+      failures++;
+
+    return Report("Instance cache", instance, cases, failures);
+  }
+
+  // Help function: true if reading the instance file exits with an error (in a child process, the parser exits)
+  bool ParseFails(const string& filename)
+  {
+    pid_t pid;
+    int status;
+
+    cout.flush();
+    pid = fork();
+    if (pid == 0)
+    {
+      cerr.rdbuf(nullptr);
+      Sched_Input in(filename);
+      _exit(0);
+    }
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 1;
+  }
+
+  // Numbers of the instance file (Tokenizer::Unsigned): leading zeros and any whitespace are accepted, negative,
+  // partial and out of range numbers are rejected
+  bool CheckNumbers(const string& input_filename, const string& instance, const string& directory)
+  {
+    const vector<string> bad_numbers = {"-6", "6x", "x6", "4294967296", "99999999999999999999", "6.0", "+6"};
+    string filename = directory + "/numbers.txt", text, changed, expected;
+    unsigned long failures = 0, cases = 0;
+    size_t position, end;
+
+    {
+      ifstream is(input_filename, ios::binary);
+      stringstream buffer;
+      buffer << is.rdbuf();
+      text = buffer.str();
+    }
+    position = text.find("Days ") + 5;
+    end = text.find_first_of(" \t\r\n", position);
+    expected = InstanceText(Sched_Input(input_filename));
+
+    changed = text.substr(0, position) + "00" + text.substr(position, end - position) + "\r\n\t" + text.substr(end);
+    RewriteFile(filename, changed, false);
+    cases++;
+    if (InstanceText(Sched_Input(filename)) != expected)
+      failures++;
+
+    for (const string& number : bad_numbers)
+    {
+      RewriteFile(filename, text.substr(0, position) + number + text.substr(end), false);
+      cases++;
+      if (!ParseFails(filename))
+        failures++;
+    }
+
+    return Report("Instance numbers", instance, cases, failures);
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  string directory = (filesystem::temp_directory_path() / "sched_check_XXXXXX").string();
+  bool passed = true;
+  int i;
+
+  if (argc < 2)
+  {
+    cerr << "Usage: " << argv[0] << " <instance files>" << endl;
+    return 1;
+  }
+  if (mkdtemp(directory.data()) == nullptr)
+  {
+    cerr << "Cannot create temporary directory " << directory << endl;
+    return 1;
+  }
+
+  for (i = 1; i < argc; i++)
+  {
+    const string instance = filesystem::path(argv[i]).filename().string();
+    Sched_Input in(argv[i]);
+    Random::SetSeed(i);
+
+    Sched_ProfUnavailability_CC cc_PU(in, in.UnavailabilityViolationCost(), false);
+    Sched_MaxSubjectHoursXDay_CC cc_MSHD(in, in.MaxSubjectHoursXDayViolationCost(), false);
+    Sched_ProfMaxWeeklyHours_CC cc_PWMH(in, in.MaxProfWeeklyHoursViolationCost(), false);
+    Sched_ScheduleContiguity_CC cc_SC(in, in.ScheduleContiguityViolationCost(), false);
+    Sched_SolutionComplete_CC cc_CS(in, 1, true);
+    Sched_DeltaCost delta_cost(in, cc_PU, cc_MSHD, cc_PWMH, cc_SC, cc_CS);
+
+    Sched_SolutionManager sm(in);
+    sm.AddCostComponent(cc_PU);
+    sm.AddCostComponent(cc_MSHD);
+    sm.AddCostComponent(cc_PWMH);
+    sm.AddCostComponent(cc_SC);
+    sm.AddCostComponent(cc_CS);
+
+    Sched_SwapHours_NeighborhoodExplorer swap_h_nhe(in, sm, delta_cost);
+    Sched_AssignProf_NeighborhoodExplorer assign_p_nhe(in, sm, delta_cost);
+    Sched_SwapProf_NeighborhoodExplorer swap_p_nhe(in, sm, delta_cost);
+    Sched_CrossSwapHours_NeighborhoodExplorer cross_h_nhe(in, sm, delta_cost);
+    Sched_KempeChain_NeighborhoodExplorer kempe_nhe(in, sm, delta_cost);
+
+    passed &= CheckMoves<Sched_SwapHours_NeighborhoodExplorer, Sched_SwapHours>(in, instance, sm, swap_h_nhe, "SwapHours");
+    passed &= CheckMoves<Sched_AssignProf_NeighborhoodExplorer, Sched_AssignProf>(in, instance, sm, assign_p_nhe, "AssignProf");
+    passed &= CheckMoves<Sched_SwapProf_NeighborhoodExplorer, Sched_SwapProf>(in, instance, sm, swap_p_nhe, "SwapProf");
+    passed &= CheckMoves<Sched_CrossSwapHours_NeighborhoodExplorer, Sched_CrossSwapHours>(in, instance, sm, cross_h_nhe, "CrossSwapHours");
+    passed &= CheckMoves<Sched_KempeChain_NeighborhoodExplorer, Sched_KempeChain>(in, instance, sm, kempe_nhe, "KempeChain");
+    passed &= CheckKempeChains(in, instance, sm);
+    passed &= CheckSnapshots(in, instance, sm, directory);
+    passed &= CheckInstanceCache(argv[i], instance, directory);
+    passed &= CheckNumbers(argv[i], instance, directory);
+  }
+
+  filesystem::remove_all(directory);
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+// File Sched_Checkpointer.cc
+#include "Sched_Checkpointer.hh"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+namespace
+{
+  // Checkpoint layout: magic, uint32 version, runner, double elapsed, counters (uint32 count, uint64 each), values
+  // (uint32 count, double each), generators, moves and states (uint32 count, then uint64 length and bytes each; a state
+  // is a Sched_Output snapshot)
+  const char checkpoint_magic[8] = {'S', 'C', 'H', 'E', 'D', 'C', 'K', 'P'};
+  const uint32_t checkpoint_format_version = 2;
+
+  template <typename T>
+  void WriteValue(ostream& os, T value)
+  {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void WriteBytes(ostream& os, const string& bytes)
+  {
+    WriteValue<uint64_t>(os, bytes.size());
+    os.write(bytes.data(), bytes.size());
+  }
+
+  // Help class: reads the fields of a checkpoint held in memory, throws if the data end too early
+  class CheckpointReader
+  {
+  public:
+    CheckpointReader(const string& data, size_t position) : data(data), position(position) {}
+    template <typename T>
+    T Value()
+    {
+      T value;
+
+      Need(sizeof(T));
+      memcpy(&value, data.data() + position, sizeof(T));
+      position += sizeof(T);
+      return value;
+    }
+    const char* Bytes(size_t& size)
+    {
+      const char* bytes;
+
+      size = Value<uint64_t>();
+      Need(size);
+      bytes = data.data() + position;
+      position += size;
+      return bytes;
+    }
+    bool AtEnd() const { return position == data.size(); }
+  private:
+    void Need(size_t size)
+    {
+      if (data.size() - position < size)
+        throw runtime_error("Truncated checkpoint.");
+    }
+    const string& data;
+    size_t position;
+  };
+}
+
+Sched_Checkpointer::Sched_Checkpointer(const string& pfilename, double pinterval)
+  : filename(pfilename),
+    interval(pinterval),
+    has_pending(false),
+    stopping(false),
+    due(false),
+    written(0)
+{
+  if (pinterval <= 0)
+    throw runtime_error("Checkpoints need a positive interval");
+
+  writer = thread(&Sched_Checkpointer::WriterLoop, this);
+}
+
+Sched_Checkpointer::~Sched_Checkpointer()
+{
+  Close();
+}
+
+void Sched_Checkpointer::Close()
+{
+  if (writer.joinable())
+  {
+    {
+      lock_guard<mutex> lock(checkpoint_mutex);
+      stopping = true;
+    }
+    checkpoint_condition.notify_all();
+    writer.join();
+  }
+}
+
+// The search thread only pays for the copy of its state, made before the call
+void Sched_Checkpointer::Submit(Checkpoint&& checkpoint)
+{
+  {
+    lock_guard<mutex> lock(checkpoint_mutex);
+    pending = move(checkpoint);
+    has_pending = true;
+    due = false;
+  }
+  checkpoint_condition.notify_all();
+}
+
+void Sched_Checkpointer::WriterLoop()
+{
+  Checkpoint checkpoint;
+  unique_lock<mutex> lock(checkpoint_mutex);
+
+  for (;;)
+  {
+    if (!checkpoint_condition.wait_for(lock, interval, [this]() { return has_pending || stopping; }))
+    { // a checkpoint is due at the next chance the search thread has
+      due = true;
+      continue;
+    }
+
+    if (has_pending)
+    {
+      checkpoint = move(pending);
+      has_pending = false;
+      lock.unlock();
+      try
+      {
+        Write(filename, checkpoint);
+        written++;
+      }
+      catch (const runtime_error& e)
+      {
+        cerr << e.what() << endl;
+      }
+      lock.lock();
+    }
+    else if (stopping)
+      return;
+  }
+}
+
+void Sched_Checkpointer::Write(const string& filename, const Checkpoint& checkpoint)
+{
+  string temporary_filename = filename + ".tmp" + to_string(getpid());
+  ofstream os(temporary_filename, ios::binary);
+  ostringstream snapshot;
+
+  os.write(checkpoint_magic, sizeof(checkpoint_magic));
+  WriteValue<uint32_t>(os, checkpoint_format_version);
+  WriteBytes(os, checkpoint.runner);
+  WriteValue<double>(os, checkpoint.elapsed);
+
+  WriteValue<uint32_t>(os, checkpoint.counters.size());
+  for (unsigned long counter : checkpoint.counters)
+    WriteValue<uint64_t>(os, counter);
+
+  WriteValue<uint32_t>(os, checkpoint.values.size());
+  for (double value : checkpoint.values)
+    WriteValue<double>(os, value);
+
+  WriteValue<uint32_t>(os, checkpoint.generators.size());
+  for (const string& generator : checkpoint.generators)
+    WriteBytes(os, generator);
+
+  WriteValue<uint32_t>(os, checkpoint.moves.size());
+  for (const string& mv : checkpoint.moves)
+    WriteBytes(os, mv);
+
+  WriteValue<uint32_t>(os, checkpoint.states.size());
+  for (const Sched_Output& st : checkpoint.states)
+  {
+    snapshot.str("");
+    st.WriteSnapshot(snapshot);
+    WriteBytes(os, snapshot.str());
+  }
+
+  os.close();
+  if (!os || rename(temporary_filename.c_str(), filename.c_str()) != 0)
+  {
+    remove(temporary_filename.c_str());
+    throw runtime_error("Cannot write checkpoint " + filename + ".");
+  }
+}
+
+Sched_Checkpointer::Checkpoint Sched_Checkpointer::Read(const string& filename, const Sched_Input& in)
+{
+  Checkpoint checkpoint;
+  ifstream is(filename, ios::binary);
+  stringstream buffer;
+  string data;
+  const char* bytes;
+  size_t size;
+  unsigned i, n;
+
+  if (!is)
+    throw runtime_error("Cannot open checkpoint " + filename + ".");
+  buffer << is.rdbuf();
+  data = buffer.str();
+
+  if (data.size() < sizeof(checkpoint_magic) || memcmp(data.data(), checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+    throw runtime_error(filename + " is not a checkpoint.");
+
+  CheckpointReader reader(data, sizeof(checkpoint_magic));
+  if (reader.Value<uint32_t>() != checkpoint_format_version)
+    throw runtime_error("Unsupported checkpoint version in " + filename + ".");
+
+  bytes = reader.Bytes(size);
+  checkpoint.runner.assign(bytes, size);
+  checkpoint.elapsed = reader.Value<double>();
+
+  n = reader.Value<uint32_t>();
+  for (i = 0; i < n; i++)
+    checkpoint.counters.push_back(reader.Value<uint64_t>());
+
+  n = reader.Value<uint32_t>();
+  for (i = 0; i < n; i++)
+    checkpoint.values.push_back(reader.Value<double>());
+
+  n = reader.Value<uint32_t>();
+  for (i = 0; i < n; i++)
+  {
+    bytes = reader.Bytes(size);
+    checkpoint.generators.emplace_back(bytes, size);
+  }
+
+  n = reader.Value<uint32_t>();
+  for (i = 0; i < n; i++)
+  {
+    bytes = reader.Bytes(size);
+    checkpoint.moves.emplace_back(bytes, size);
+  }
+
+  // The snapshots check that the states belong to the instance
+  n = reader.Value<uint32_t>();
+  for (i = 0; i < n; i++)
+  {
+    bytes = reader.Bytes(size);
+    checkpoint.states.emplace_back(in);
+    checkpoint.states.back().LoadSnapshot(bytes, size);
+  }
+
+  if (!reader.AtEnd())
+    throw runtime_error("Trailing data in checkpoint " + filename + ".");
+  return checkpoint;
+}
@@ -0,0 +1,64 @@
+// File Sched_Checkpointer.hh
+#ifndef SCHED_CHECKPOINTER_HH
+#define SCHED_CHECKPOINTER_HH
+
+#include "Sched_Data.hh"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+// Periodic checkpoints of a run. A writer thread raises Due() every interval seconds; the search thread then
+// copies its state in a Checkpoint and hands it over with Submit, and the writer saves it to the file (through
+// a temporary file, so that the last complete checkpoint survives a kill during the write)
+class Sched_Checkpointer
+{
+public:
+  // What each runner stores is its own business: the EasyLocal runners store the current and the best state, their
+  // counters and their own state (SA temperature, TS tabu list), parallel tempering the state and the best state of
+  // each replica
+  struct Checkpoint
+  {
+    string runner;                    // method of the run
+    double elapsed = 0.0;             // running time up to the checkpoint (s)
+    vector<unsigned long> counters;   // iterations, exchanges, positions, ...
+    vector<double> values;            // temperatures, ...
+    vector<string> generators;        // random generator states (operator<< format), EasyLocal Random first
+    vector<string> moves;             // moves (operator<< format), e.g. a tabu list
+    vector<Sched_Output> states;
+  };
+
+  Sched_Checkpointer(const string& filename, double interval);
+  ~Sched_Checkpointer();
+
+  bool Due() const { return due.load(memory_order_relaxed); }
+  void Submit(Checkpoint&& checkpoint);
+  void Close();   // writes the pending checkpoint and stops the writer
+
+  unsigned long Written() const { return written; }
+
+  // Throws runtime_error if the file is not a checkpoint of the instance
+  static Checkpoint Read(const string& filename, const Sched_Input& in);
+  static void Write(const string& filename, const Checkpoint& checkpoint);
+protected:
+  void WriterLoop();
+
+  string filename;
+  chrono::duration<double> interval;
+
+  mutex checkpoint_mutex;
+  condition_variable checkpoint_condition;
+  Checkpoint pending;
+  bool has_pending;
+  bool stopping;
+  atomic<bool> due;
+  atomic<unsigned long> written;
+  thread writer;
+};
+
+#endif
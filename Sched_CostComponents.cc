@@ -1,12 +1,272 @@
 // File Sched_CostComponents.cc
 #include "Sched_Headers.hh"
 
+namespace
+{
+  // Change of the contiguity violations of subject s in class c when one of its hours moves from (d_from, h_from) to (d_to, h_to)
+  int MovedHourContiguityDelta(const Sched_Output& out, unsigned c, unsigned s, unsigned d_from, unsigned h_from, unsigned d_to, unsigned h_to)
+  {
+    uint64_t from_hours = out.ClassSubjectDayMask(c, d_from, s);
+    uint64_t to_hours;
+
+    if (d_from == d_to)
+      return (int)Sched_Output::ContiguityGaps((from_hours & ~((uint64_t)1 << h_from)) | ((uint64_t)1 << h_to)) - (int)Sched_Output::ContiguityGaps(from_hours);
+
+    to_hours = out.ClassSubjectDayMask(c, d_to, s);
+    return (int)Sched_Output::ContiguityGaps(from_hours & ~((uint64_t)1 << h_from)) - (int)Sched_Output::ContiguityGaps(from_hours)
+      + (int)Sched_Output::ContiguityGaps(to_hours | ((uint64_t)1 << h_to)) - (int)Sched_Output::ContiguityGaps(to_hours);
+  }
+
+  // Change of the unavailability violation of professor p when he gains net_hours on day_1 and loses them on day_2
+  // (the violation is a lesson on his unavailability day)
+  int MovedHoursUnavailabilityDelta(const Sched_Input& in, const Sched_Output& out, unsigned p, int net_hours, unsigned day_1, unsigned day_2)
+  {
+    int hours;
+
+    if (in.ProfUnavailability(p) == day_1)
+    {
+      hours = out.ProfDailyHours(p, day_1);
+      return (hours + net_hours > 0) - (hours > 0);
+    }
+    else if (in.ProfUnavailability(p) == day_2)
+    {
+      hours = out.ProfDailyHours(p, day_2);
+      return (hours - net_hours > 0) - (hours > 0);
+    }
+
+    return 0;
+  }
+
+  // Help functions: the (unweighted) deltas of all the cost components for a move, in one pass over the move
+  Sched_MoveDeltas ComputeDeltas(const Sched_Input& in, const Sched_Output& out, const Sched_SwapHours& mv)
+  {
+    Sched_MoveDeltas deltas = {0, 0, 0, 0, 0};
+    int p1 = out.Class_Schedule(mv._class, mv.day_1, mv.hour_1);
+    int p2 = out.Class_Schedule(mv._class, mv.day_2, mv.hour_2);
+    int s1 = p1 != -1 ? (int)in.ProfSubject(p1) : -1;
+    int s2 = p2 != -1 ? (int)in.ProfSubject(p2) : -1;
+
+    // Swapping two hours of the same professor (hence of the same subject) leaves the schedule unchanged
+    if (p1 == p2)
+      return deltas;
+
+    if (mv.day_1 != mv.day_2)
+    {
+      // Unavailability: subtract old costs (the professor is present only 1 hour in the day)...
+      if (p1 != -1 && in.ProfUnavailability(p1) == mv.day_1 && out.ProfDailyHours(p1, mv.day_1) == 1)
+        deltas.unavailability--;
+      if (p2 != -1 && in.ProfUnavailability(p2) == mv.day_2 && out.ProfDailyHours(p2, mv.day_2) == 1)
+        deltas.unavailability--;
+
+      // ...and add new costs (the professor was free all the day)
+      if (p1 != -1 && in.ProfUnavailability(p1) == mv.day_2 && out.ProfDailyHours(p1, mv.day_2) == 0)
+        deltas.unavailability++;
+      if (p2 != -1 && in.ProfUnavailability(p2) == mv.day_1 && out.ProfDailyHours(p2, mv.day_1) == 0)
+        deltas.unavailability++;
+
+      // Max subject hours per day: subtract old costs...
+      if (p1 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_1, s1) > in.SubjectMaxHoursXDay())
+        deltas.max_subject_hours--;
+      if (p2 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_2, s2) > in.SubjectMaxHoursXDay())
+        deltas.max_subject_hours--;
+
+      // ...and add new costs ("=" because if I am at the limit adding another one causes a violation)
+      if (p2 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_1, s2) >= in.SubjectMaxHoursXDay())
+        deltas.max_subject_hours++;
+      if (p1 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_2, s1) >= in.SubjectMaxHoursXDay())
+        deltas.max_subject_hours++;
+    }
+
+    // Contiguity: the hour of "subject 1" moves to (day_2, hour_2), the one of "subject 2" to (day_1, hour_1)
+    if (p1 != -1)
+      deltas.contiguity += MovedHourContiguityDelta(out, mv._class, s1, mv.day_1, mv.hour_1, mv.day_2, mv.hour_2);
+    if (p2 != -1)
+      deltas.contiguity += MovedHourContiguityDelta(out, mv._class, s2, mv.day_2, mv.hour_2, mv.day_1, mv.hour_1);
+
+    return deltas;
+  }
+
+  Sched_MoveDeltas ComputeDeltas(const Sched_Input& in, const Sched_Output& out, const Sched_AssignProf& mv)
+  {
+    Sched_MoveDeltas deltas;
+    unsigned s = in.ProfSubject(mv.prof);
+    uint64_t hours = out.ClassSubjectDayMask(mv._class, mv.day, s);
+
+    // There's no old costs to subtract
+    // The professor gets a lesson on his requested day off, that was free (in every class) until now
+    deltas.unavailability = in.ProfUnavailability(mv.prof) == mv.day && out.ProfDailyHours(mv.prof, mv.day) == 0 ? 1 : 0;
+    deltas.max_subject_hours = out.DailySubjectAssignedHours(mv._class, mv.day, s) >= in.SubjectMaxHoursXDay() ? 1 : 0;
+    deltas.max_weekly_hours = out.ProfWeeklyAssignedHours(mv.prof) >= in.ProfMaxWeeklyHours() ? 1 : 0;
+    // The new hour can only join runs (-1 if it fills a gap) or start a new one (+1)
+    deltas.contiguity = (int)Sched_Output::ContiguityGaps(hours | ((uint64_t)1 << mv.hour)) - (int)Sched_Output::ContiguityGaps(hours);
+    deltas.complete = -1;
+
+    return deltas;
+  }
+
+  Sched_MoveDeltas ComputeDeltas(const Sched_Input& in, const Sched_Output& out, const Sched_SwapProf& mv)
+  {
+    Sched_MoveDeltas deltas = {0, 0, 0, 0, 0};
+    unsigned prof_1, prof_2, day_off_1, day_off_2, hours_1, hours_2;
+    int p1_extra_hours, p2_extra_hours, delta;
+
+    prof_1 = out.Subject_Prof(mv.class_1, mv.subject);
+    prof_2 = out.Subject_Prof(mv.class_2, mv.subject);
+    day_off_1 = in.ProfUnavailability(prof_1);
+    day_off_2 = in.ProfUnavailability(prof_2);
+
+    // Unavailability
+    // prof_1 on the free day has at most only class_1 => there may be changes to violations
+    // (otherwise prof_1 is engaged with another class on his day off => I don't modify the violations for prof_1)
+    if (out.ProfDailyHours(prof_1, day_off_1) == (unsigned)popcount(out.ClassSubjectDayMask(mv.class_1, day_off_1, mv.subject)))
+    {
+      // No lessons are introduced on prof_1's day off AND there is a violation (I already know it's only due to class_1) => I resolve it
+      if (out.ClassSubjectDayMask(mv.class_2, day_off_1, mv.subject) == 0 && out.ProfAssignedDayOff(prof_1) != (int)day_off_1)
+        deltas.unavailability--;
+      // Lessons are introduced on prof_1's day off AND there was no violation already => I introduce it
+      else if (out.ClassSubjectDayMask(mv.class_2, day_off_1, mv.subject) != 0 && out.ProfAssignedDayOff(prof_1) == (int)day_off_1)
+        deltas.unavailability++;
+    }
+
+    // prof_2 on the free day has only class_2
+    if (out.ProfDailyHours(prof_2, day_off_2) == (unsigned)popcount(out.ClassSubjectDayMask(mv.class_2, day_off_2, mv.subject)))
+    {
+      if (out.ClassSubjectDayMask(mv.class_1, day_off_2, mv.subject) == 0 && out.ProfAssignedDayOff(prof_2) != (int)day_off_2)
+        deltas.unavailability--;
+      else if (out.ClassSubjectDayMask(mv.class_1, day_off_2, mv.subject) != 0 && out.ProfAssignedDayOff(prof_2) == (int)day_off_2)
+        deltas.unavailability++;
+    }
+
+    // Max weekly hours: the cost changes only if the number of assigned hours for that subject to the two classes is different
+    p1_extra_hours = out.ProfWeeklyAssignedHours(prof_1) - in.ProfMaxWeeklyHours();
+    p2_extra_hours = out.ProfWeeklyAssignedHours(prof_2) - in.ProfMaxWeeklyHours();
+    hours_1 = out.WeeklySubjectAssignedHours(mv.class_1, mv.subject);
+    hours_2 = out.WeeklySubjectAssignedHours(mv.class_2, mv.subject);
+
+    if (hours_1 > hours_2)
+    {
+      delta = hours_1 - hours_2;
+      if (p1_extra_hours > 0)
+        deltas.max_weekly_hours -= min(p1_extra_hours, delta);
+
+      if (p2_extra_hours > 0)
+        deltas.max_weekly_hours += delta;
+      else if (p2_extra_hours + delta > 0)
+        deltas.max_weekly_hours += p2_extra_hours + delta;
+    }
+    else if (hours_1 < hours_2)
+    {
+      delta = hours_2 - hours_1;
+      if (p2_extra_hours > 0)
+        deltas.max_weekly_hours -= min(p2_extra_hours, delta);
+
+      if (p1_extra_hours > 0)
+        deltas.max_weekly_hours += delta;
+      else if (p1_extra_hours + delta > 0)
+        deltas.max_weekly_hours += p1_extra_hours + delta;
+    }
+
+    return deltas;
+  }
+
+  Sched_MoveDeltas ComputeDeltas(const Sched_Input& in, const Sched_Output& out, const Sched_CrossSwapHours& mv)
+  {
+    Sched_MoveDeltas deltas = {0, 0, 0, 0, 0}, class_deltas;
+    Sched_SwapHours class_mv;
+    int profs[4], net_hours;
+    unsigned i, j, c;
+
+    // Daily limits and contiguity are computed on each class: it is the swap of the two hours in the class
+    class_mv.day_1 = mv.day_1;
+    class_mv.hour_1 = mv.hour_1;
+    class_mv.day_2 = mv.day_2;
+    class_mv.hour_2 = mv.hour_2;
+    for (c = 0; c < 2; c++)
+    {
+      class_mv._class = c == 0 ? mv.class_1 : mv.class_2;
+      class_deltas = ComputeDeltas(in, out, class_mv);
+      deltas.max_subject_hours += class_deltas.max_subject_hours;
+      deltas.contiguity += class_deltas.contiguity;
+    }
+
+    if (mv.day_1 == mv.day_2)
+      return deltas;
+
+    // Unavailability: the professors of the four hours (the one of the move is in two of them), each one gains
+    // net_hours on day_1 and loses them on day_2
+    profs[0] = out.Class_Schedule(mv.class_1, mv.day_1, mv.hour_1);
+    profs[1] = out.Class_Schedule(mv.class_2, mv.day_1, mv.hour_1);
+    profs[2] = out.Class_Schedule(mv.class_1, mv.day_2, mv.hour_2);
+    profs[3] = out.Class_Schedule(mv.class_2, mv.day_2, mv.hour_2);
+
+    for (i = 0; i < 4; i++)
+    {
+      if (profs[i] == -1)
+        continue;
+      for (j = 0; j < i && profs[j] != profs[i]; j++)
+        ;
+      if (j < i)
+        continue;
+
+      net_hours = 0;
+      for (j = 0; j < 4; j++)
+        if (profs[j] == profs[i])
+          net_hours += j < 2 ? -1 : 1;
+
+      deltas.unavailability += MovedHoursUnavailabilityDelta(in, out, profs[i], net_hours, mv.day_1, mv.day_2);
+    }
+
+    return deltas;
+  }
+
+  Sched_MoveDeltas ComputeDeltas(const Sched_Input& in, const Sched_Output& out, const Sched_KempeChain& mv)
+  {
+    thread_local vector<unsigned> chain;
+    Sched_MoveDeltas deltas = {0, 0, 0, 0, 0}, class_deltas;
+    Sched_SwapHours class_mv;
+    unsigned i;
+    int p;
+
+    out.KempeChain(mv._class, mv.day_1, mv.hour_1, mv.day_2, mv.hour_2, chain);
+
+    // Daily limits and contiguity are computed on each class of the chain: it is the swap of the two hours in the class
+    class_mv.day_1 = mv.day_1;
+    class_mv.hour_1 = mv.hour_1;
+    class_mv.day_2 = mv.day_2;
+    class_mv.hour_2 = mv.hour_2;
+    for (i = 0; i < chain.size(); i++)
+    {
+      class_mv._class = chain[i];
+      class_deltas = ComputeDeltas(in, out, class_mv);
+      deltas.max_subject_hours += class_deltas.max_subject_hours;
+      deltas.contiguity += class_deltas.contiguity;
+    }
+
+    if (mv.day_1 == mv.day_2)
+      return deltas;
+
+    // Unavailability: all the lessons of the two hours of a professor are in the chain, so he gains one hour on day_1
+    // if he teaches only at hour 2 and loses one if he teaches only at hour 1 (each professor is taken from his first hour)
+    for (i = 0; i < chain.size(); i++)
+    {
+      if ((p = out.Class_Schedule(chain[i], mv.day_1, mv.hour_1)) != -1 && out.IsProfHourFree(p, mv.day_2, mv.hour_2))
+        deltas.unavailability += MovedHoursUnavailabilityDelta(in, out, p, -1, mv.day_1, mv.day_2);
+      if ((p = out.Class_Schedule(chain[i], mv.day_2, mv.hour_2)) != -1 && out.IsProfHourFree(p, mv.day_1, mv.hour_1))
+        deltas.unavailability += MovedHoursUnavailabilityDelta(in, out, p, 1, mv.day_1, mv.day_2);
+    }
+
+    return deltas;
+  }
+}
+
 /***************************************************************************
  * Cost Components Code
  ***************************************************************************/
 
   int Sched_ProfUnavailability_CC::ComputeCost(const Sched_Output& out) const
 {
+  SCHED_PROFILE(COST_FUNCTION, PROF_UNAVAILABILITY);
+
   unsigned p;
   unsigned violations = 0;
 
@@ -36,16 +296,10 @@ void Sched_ProfUnavailability_CC::PrintViolations(const Sched_Output& out, ostre
 
 int Sched_MaxSubjectHoursXDay_CC::ComputeCost(const Sched_Output& out) const
 {
-  unsigned c, s, d;
-  unsigned violations = 0;
+  SCHED_PROFILE(COST_FUNCTION, MAX_SUBJECT_HOURS_X_DAY);
 
-  for (c = 0; c < in.N_Classes(); c++)
-    for (d = 0; d < in.N_Days(); d++)
-      for (s = 0; s < in.N_Subjects(); s++)
-        if (out.DailySubjectAssignedHours(c, d, s) > in.SubjectMaxHoursXDay())
-          violations += out.DailySubjectAssignedHours(c, d, s) - in.SubjectMaxHoursXDay();
-
-  return violations;
+  // Sum over (class, day, subject) of the hours beyond SubjectMaxHoursXDay, maintained by Sched_Output
+  return out.MaxSubjectHoursXDayViolations();
 }
 
 void Sched_MaxSubjectHoursXDay_CC::PrintViolations(const Sched_Output& out, ostream& os) const
@@ -64,6 +318,8 @@ void Sched_MaxSubjectHoursXDay_CC::PrintViolations(const Sched_Output& out, ostr
 
 int Sched_ProfMaxWeeklyHours_CC::ComputeCost(const Sched_Output& out) const
 {
+  SCHED_PROFILE(COST_FUNCTION, PROF_MAX_WEEKLY_HOURS);
+
   unsigned p;
   unsigned violations = 0;
 
@@ -87,30 +343,10 @@ void Sched_ProfMaxWeeklyHours_CC::PrintViolations(const Sched_Output& out, ostre
 
 int Sched_ScheduleContiguity_CC::ComputeCost(const Sched_Output& out) const
 {
-  unsigned c, s, d, h;
-  int subject_last_position;
-  unsigned violations = 0;
+  SCHED_PROFILE(COST_FUNCTION, SCHEDULE_CONTIGUITY);
 
-  if (in.N_HoursXDay() < 3)
-    return 0;
-
-  for (c = 0; c < in.N_Classes(); c++)
-    for (s = 0; s < in.N_Subjects(); s++)
-      for (d = 0; d < in.N_Days(); d++)
-      {
-        subject_last_position = -1;
-
-        for (h = 0; h < in.N_HoursXDay(); h++)
-          if (out.Class_Schedule(c, d, h) != -1 && in.ProfSubject(out.Class_Schedule(c, d, h)) == s)
-          {
-            if (subject_last_position != -1 && h - subject_last_position > 1)
-              violations++;
-
-            subject_last_position = h;
-          }
-      }
-
-  return violations;
+  // Sum over (class, day, subject) of the gaps between the runs of hours, maintained by Sched_Output
+  return out.ContiguityViolations();
 }
 
 void Sched_ScheduleContiguity_CC::PrintViolations(const Sched_Output& out, ostream& os) const
@@ -143,16 +379,10 @@ void Sched_ScheduleContiguity_CC::PrintViolations(const Sched_Output& out, ostre
 
 int Sched_SolutionComplete_CC::ComputeCost(const Sched_Output& out) const
 {
-  unsigned c, d, h;
-  unsigned violations = 0;
+  SCHED_PROFILE(COST_FUNCTION, SOLUTION_COMPLETE);
 
-  for (c = 0; c < in.N_Classes(); c++)
-    for (d = 0; d < in.N_Days(); d++)
-      for (h = 0; h < in.N_HoursXDay(); h++)
-        if (out.IsClassHourFree(c, d, h))
-          violations++;
-
-  return violations;
+  // Free hours of all the classes, maintained by Sched_Output
+  return out.FreeClassHours();
 }
 
 void Sched_SolutionComplete_CC::PrintViolations(const Sched_Output& out, ostream& os) const
@@ -170,354 +400,64 @@ void Sched_SolutionComplete_CC::PrintViolations(const Sched_Output& out, ostream
 }
 
 /***************************************************************************
- * Delta Cost Components Code - Sched_SwapHours
+ * Fused Delta Cost Code
  ***************************************************************************/
 
-int Sched_SwapHoursDeltaProfUnavailability::ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const
-{
-  unsigned h;
-  int p1, p2;
-  int cost = 0;
-
-  p1 = out.Class_Schedule(mv._class, mv.day_1, mv.hour_1);
-  p2 = out.Class_Schedule(mv._class, mv.day_2, mv.hour_2);
-
-  if (mv.day_1 == mv.day_2)
-    return 0;
-
-  // Subtract old costs
-  if (p1 != -1 && in.ProfUnavailability(p1) == mv.day_1)
-  {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (!out.IsProfHourFree(p1, mv.day_1, h) && mv.hour_1 != h) // if I find the professor in another hour of the same day
-        break;
-    if (h == in.N_HoursXDay()) // The professor is present only 1 hour in the day
-      cost--;  
-  }
-
-  if (p2 != -1 && in.ProfUnavailability(p2) == mv.day_2)
-  {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (!out.IsProfHourFree(p2, mv.day_2, h) && mv.hour_2 != h)
-        break;
-    if (h == in.N_HoursXDay())
-      cost--;  
-  }
-
-  // Add new costs
-  if (p1 != -1 && in.ProfUnavailability(p1) == mv.day_2)
-  {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (!out.IsProfHourFree(p1, mv.day_2, h) && mv.hour_2 != h)
-        break;
-    if (h == in.N_HoursXDay())
-      cost++;
-  }
-
-  if (p2 != -1 && in.ProfUnavailability(p2) == mv.day_1)
-  {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (!out.IsProfHourFree(p2, mv.day_1, h) && mv.hour_1 != h)
-        break;
-    if (h == in.N_HoursXDay())
-      cost++;
-  }
-
-  return cost;
-}
-
-int Sched_SwapHoursDeltaMaxSubjectHoursXDay::ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const
-{
-  int p1, p2;
-  int cost = 0;
-
-  p1 = out.Class_Schedule(mv._class, mv.day_1, mv.hour_1);
-  p2 = out.Class_Schedule(mv._class, mv.day_2, mv.hour_2);
-
-  if (mv.day_1 == mv.day_2)
-    return 0;
-
-  // Subtract old costs
-  if (p1 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_1, in.ProfSubject(p1)) > in.SubjectMaxHoursXDay())
-    cost--;
-
-  if (p2 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_2, in.ProfSubject(p2)) > in.SubjectMaxHoursXDay())
-    cost--;
-
-  // Add new costs
-  if (p2 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_1, in.ProfSubject(p2)) >= in.SubjectMaxHoursXDay()) // add the case "=" because if I am at the limit adding another one cause a violation
-    cost++;
-
-  if (p1 != -1 && out.DailySubjectAssignedHours(mv._class, mv.day_2, in.ProfSubject(p1)) >= in.SubjectMaxHoursXDay())
-    cost++;
-
-  return cost;
-}
-
-int Sched_SwapHoursDeltaScheduleContiguity::ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const
-{
-  unsigned h;
-  int cost = 0;
-
-  int p1 = out.Class_Schedule(mv._class, mv.day_1, mv.hour_1);
-  int p2 = out.Class_Schedule(mv._class, mv.day_2, mv.hour_2);
-
-  int last_old_1 = -1;
-  int last_old_2 = -1;
-  int last_res_1 = -1;
-  int last_res_2 = -1;
-  int last_new_1 = -1;
-  int last_new_2 = -1;
-  int last_arr_1 = -1;
-  int last_arr_2 = -1;
-
-  // Iterating over the schedule hour by hour, considering only the days involved in the hour swap
-  for (h = 0; h < in.N_HoursXDay(); h++)
-  {
-    // Current violations of "subject 1" on the day involved in the swap
-    if (p1 != -1 && out.Class_Schedule(mv._class, mv.day_1, h) == p1)
-    {
-      if (last_old_1 != -1 && h - last_old_1 > 1)
-        cost--;
-      last_old_1 = h;
-    }
-
-    // Current violations of "subject 2" on the day involved in the swap
-    if (p2 != -1 && out.Class_Schedule(mv._class, mv.day_2, h) == p2)
-    {
-      if (last_old_2 != -1 && h - last_old_2 > 1)
-        cost--;
-      last_old_2 = h;
-    }
-
-    // Violations already present on the arrival day - but only if different days
-    if (mv.day_1 != mv.day_2)
-    {
-      if (p1 != -1 && out.Class_Schedule(mv._class, mv.day_2, h) == p1)
-      {
-        if (last_arr_1 != -1 && h - last_arr_1 > 1)
-          cost--;
-        last_arr_1 = h;
-      }
-
-      if (p2 != -1 && out.Class_Schedule(mv._class, mv.day_1, h) == p2)
-      {
-        if (last_arr_2 != -1 && h - last_arr_2 > 1)
-          cost--;
-        last_arr_2 = h;
-      }
-    }
-
-    // Violations of "subject 1" on the day currently occupied by "subject 2" if the swap is made.
-    // NOTE: the hour on day 2 is currently occupied by subject 1, or it's the hour that will be occupied by "subject 1" if the swap is made.
-    if (p1 != -1 && (out.Class_Schedule(mv._class, mv.day_2, h) == p1 || h == mv.hour_2) && !(mv.day_1 == mv.day_2 && h == mv.hour_1))
-    {
-      if (last_new_1 != -1 && h - last_new_1 > 1)
-        cost++;
-      last_new_1 = h;
-    }
-
-    // Violations of "subject 2" on the day currently occupied by "subject 1" if the swap is made.
-    if (p2 != -1 && (out.Class_Schedule(mv._class, mv.day_1, h) == p2 || h == mv.hour_1) && !(mv.day_1 == mv.day_2 && h == mv.hour_2))
-    {
-      if (last_new_2 != -1 && h - last_new_2 > 1)
-        cost++;
-      last_new_2 = h;
-    }
+Sched_DeltaCost::Sched_DeltaCost(const Sched_Input& pin, const Sched_ProfUnavailability_CC& cc_PU, const Sched_MaxSubjectHoursXDay_CC& cc_MSHD,
+                                 const Sched_ProfMaxWeeklyHours_CC& cc_PMWH, const Sched_ScheduleContiguity_CC& cc_SC, const Sched_SolutionComplete_CC& cc_CS)
+  : in(pin), components{&cc_PU, &cc_MSHD, &cc_PMWH, &cc_SC, &cc_CS}
+{}
 
-    // Residual violations on the departure day. only if different days
-    if (mv.day_1 != mv.day_2)
-    {
-      if (p1 != -1 && out.Class_Schedule(mv._class, mv.day_1, h) == p1 && h != mv.hour_1)
-      {
-        if (last_res_1 != -1 && h - last_res_1 > 1)
-          cost++;
-        last_res_1 = h;
-      }
-
-      if (p2 != -1 && out.Class_Schedule(mv._class, mv.day_2, h) == p2 && h != mv.hour_2)
-      {
-        if (last_res_2 != -1 && h - last_res_2 > 1)
-          cost++;
-        last_res_2 = h;
-      }
-    }
-  }
-  return cost;
-}
-
-
-/***************************************************************************
- * Delta Cost Components Code - Sched_AssignProf
- ***************************************************************************/
-
-int Sched_AssignProfDeltaProfUnavailability::ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const
+DefaultCostStructure<int> Sched_DeltaCost::CostStructure(const Sched_MoveDeltas& deltas) const
 {
-  unsigned h;
+  const int unweighted[5] = {deltas.unavailability, deltas.max_subject_hours, deltas.max_weekly_hours, deltas.contiguity, deltas.complete};
+  vector<int> all_components(5);
+  int violations = 0, objective = 0;
+  unsigned i;
 
-  // There's no old costs to subtract
-
-  if (in.ProfUnavailability(mv.prof) == mv.day)
+  for (i = 0; i < 5; i++)
   {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (out.Class_Schedule(mv._class, mv.day, h) == mv.prof && h != mv.hour) // if I find the professor at another hour of the same day
-        return 0;
-
-    // I reached the end of the loop so the professor is present only 1 hour in the day --> I get one (1) violation
-    return 1;
+    all_components[i] = components[i]->Weight() * unweighted[i];
+    if (components[i]->IsHard())
+      violations += all_components[i];
+    else
+      objective += all_components[i];
   }
 
-  // The day where the professor is added is not his requested day off
-  return 0;
+  return DefaultCostStructure<int>(HARD_WEIGHT * violations + objective, violations, objective, all_components);
 }
 
-int Sched_AssignProfDeltaMaxSubjectHoursXDay::ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const
+DefaultCostStructure<int> Sched_DeltaCost::DeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const
 {
-  // There's no old costs to subtract
+  SCHED_PROFILE(SWAP_HOURS, FUSED_DELTAS);
 
-  if (out.DailySubjectAssignedHours(mv._class, mv.day, in.ProfSubject(mv.prof)) >= in.SubjectMaxHoursXDay())
-    return 1;
-
-  return 0;
+  return CostStructure(ComputeDeltas(in, out, mv));
 }
 
-int Sched_AssignProfDeltaProfMaxWeeklyHours::ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const
+DefaultCostStructure<int> Sched_DeltaCost::DeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const
 {
-  // There's no old costs to subtract
-
-  if (out.ProfWeeklyAssignedHours(mv.prof) >= in.ProfMaxWeeklyHours())
-    return 1;
+  SCHED_PROFILE(ASSIGN_PROF, FUSED_DELTAS);
 
-  return 0;
+  return CostStructure(ComputeDeltas(in, out, mv));
 }
 
-int Sched_AssignProfDeltaScheduleContiguity::ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const
+DefaultCostStructure<int> Sched_DeltaCost::DeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const
 {
-  unsigned h;
-  int last_hour = -1;
-
-  // There's no old costs to subtract
+  SCHED_PROFILE(SWAP_PROF, FUSED_DELTAS);
 
-  // If I place the new hour next to one of the same subject, the cost remains unchanged
-  if (mv.hour > 0)
-    if (out.Class_Schedule(mv._class, mv.day, mv.hour - 1) == mv.prof)
-      return 0;
-
-  // If I place the new hour before one of the same subject, the cost remains unchanged
-  if (mv.hour < in.N_HoursXDay() - 1)
-    if (out.Class_Schedule(mv._class, mv.day, mv.hour + 1) == mv.prof)
-      return 0;
-
-  // Case in which I place the new hour far from the other hours of the same subject -> in any case I introduce a delta in the cost equal to 1
-  for (h = 0; h < in.N_HoursXDay(); h++)
-  {
-    if (out.Class_Schedule(mv._class, mv.day, h) == mv.prof || h == mv.hour)
-    {
-      if (last_hour != -1 && h - last_hour > 1)
-        return 1;
-
-      last_hour = h;
-    }
-  }
-  return 0;
+  return CostStructure(ComputeDeltas(in, out, mv));
 }
 
-
-
-/***************************************************************************
- * Delta Cost Components Code - Sched_SwapProf
- ***************************************************************************/
-
-int Sched_SwapProfDeltaProfUnavailability::ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const
+DefaultCostStructure<int> Sched_DeltaCost::DeltaCost(const Sched_Output& out, const Sched_CrossSwapHours& mv) const
 {
-  unsigned prof_1, prof_2, h;
-  int cost = 0;
-
-  prof_1 = out.Subject_Prof(mv.class_1, mv.subject);
-  prof_2 = out.Subject_Prof(mv.class_2, mv.subject);
+  SCHED_PROFILE(CROSS_SWAP_HOURS, FUSED_DELTAS);
 
-  for (h = 0; h < in.N_HoursXDay(); h++)
-    if (!out.IsProfHourFree(prof_1, in.ProfUnavailability(prof_1), h) && out.Prof_Schedule(prof_1, in.ProfUnavailability(prof_1), h) != mv.class_1)
-      break; // prof_1 is engaged with another class on his day off => I don't modify the violations for prof_1
-  if (h == in.N_HoursXDay()) // prof_1 on the free day has at most only class_1 => there may be changes to violations
-  {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (out.Prof_Schedule(prof_2, in.ProfUnavailability(prof_1), h) == mv.class_2)
-        break; // a lesson is introduced on prof_1's day off
-    // No lessons are introduced on prof_1's day off AND there is a violation (I already know it's only due to class_1) => I resolve it
-    if (h == in.N_HoursXDay() && out.ProfAssignedDayOff(prof_1) != in.ProfUnavailability(prof_1))
-      cost--;
-    // Lessons are introduced on prof_1's day off AND there was no violation already => I introduce it
-    else if (h < in.N_HoursXDay() && out.ProfAssignedDayOff(prof_1) == in.ProfUnavailability(prof_1))
-      cost++;
-    // else => I don't change anything
-  }
-
-  for (h = 0; h < in.N_HoursXDay(); h++)
-    if (!out.IsProfHourFree(prof_2, in.ProfUnavailability(prof_2), h) && out.Prof_Schedule(prof_2, in.ProfUnavailability(prof_2), h) != mv.class_2)
-      break; // prof_2 is engaged with another class on their day off
-  if (h == in.N_HoursXDay()) // prof_2 on the free day has only class_2
-  {
-    for (h = 0; h < in.N_HoursXDay(); h++)
-      if (out.Prof_Schedule(prof_1, in.ProfUnavailability(prof_2), h) == mv.class_1)
-        break; // a lesson is introduced on prof_2's day off
-    // No lessons are introduced on prof_2's day off AND there is a violation (I already know it's only due to class_2) => I resolve it
-    if (h == in.N_HoursXDay() && out.ProfAssignedDayOff(prof_2) != in.ProfUnavailability(prof_2))
-      cost--;
-    // Lessons are introduced on prof_2's day off AND there was no violation already => I introduce it
-    else if (h < in.N_HoursXDay() && out.ProfAssignedDayOff(prof_2) == in.ProfUnavailability(prof_2))
-      cost++;
-    // else => I don't change anything
-  }
-  return cost;
+  return CostStructure(ComputeDeltas(in, out, mv));
 }
 
-// the cost is not 0 only if the number of assigned hours for that subject to the two classes is different
-int Sched_SwapProfDeltaProfMaxWeeklyHours::ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const
+DefaultCostStructure<int> Sched_DeltaCost::DeltaCost(const Sched_Output& out, const Sched_KempeChain& mv) const
 {
-  unsigned p1, p2;
-  int p1_extra_hours, p2_extra_hours, delta;
-  int cost = 0;
-
-  p1 = out.Subject_Prof(mv.class_1, mv.subject);
-  p2 = out.Subject_Prof(mv.class_2, mv.subject);
-
-  p1_extra_hours = out.ProfWeeklyAssignedHours(p1) - in.ProfMaxWeeklyHours();
-  p2_extra_hours = out.ProfWeeklyAssignedHours(p2) - in.ProfMaxWeeklyHours();
-
-  if (out.WeeklySubjectAssignedHours(mv.class_1, mv.subject) > out.WeeklySubjectAssignedHours(mv.class_2, mv.subject))
-  {
-    delta = out.WeeklySubjectAssignedHours(mv.class_1, mv.subject) - out.WeeklySubjectAssignedHours(mv.class_2, mv.subject);
-    if (p1_extra_hours > 0)
-    {
-      if (p1_extra_hours > delta)
-        cost -= delta;
-      else
-        cost -= p1_extra_hours;
-    }
-
-    if (p2_extra_hours > 0)
-      cost += delta;
-    else if (p2_extra_hours + delta > 0)
-      cost += p2_extra_hours + delta;
-  }
-
-  if (out.WeeklySubjectAssignedHours(mv.class_1, mv.subject) < out.WeeklySubjectAssignedHours(mv.class_2, mv.subject))
-  {
-    delta = out.WeeklySubjectAssignedHours(mv.class_2, mv.subject) - out.WeeklySubjectAssignedHours(mv.class_1, mv.subject);
-    if (p2_extra_hours > 0)
-    {
-      if (p2_extra_hours > delta)
-        cost -= delta;
-      else
-        cost -= p2_extra_hours;
-    }
-
-    if (p1_extra_hours > 0)
-      cost += delta;
-    else if (p1_extra_hours + delta > 0)
-      cost += p1_extra_hours + delta;
-  }
+  SCHED_PROFILE(KEMPE_CHAIN, FUSED_DELTAS);
 
-  return cost;
+  return CostStructure(ComputeDeltas(in, out, mv));
 }
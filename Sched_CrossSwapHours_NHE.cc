@@ -0,0 +1,271 @@
+// File Sched_CrossSwapHours_NHE.cc
+#include "Sched_Headers.hh"
+
+namespace
+{
+  // Help function: sets the move to the first pair of hours of class c, starting from hour slot_1 of the class: the hour of
+  //                class c and another hour of its professor (with a different class)
+  bool FirstHoursPair(const Sched_Input& in, const Sched_Output& out, Sched_CrossSwapHours& mv, unsigned c, unsigned slot_1)
+  {
+    uint64_t hours = slot_1 < 64 ? out.ClassMask(c) & (~(uint64_t)0 << slot_1) : 0;
+    uint64_t other_hours;
+    int prof;
+
+    while (hours != 0)
+    {
+      slot_1 = countr_zero(hours);
+      hours &= hours - 1;
+
+      prof = out.Class_Schedule(c, slot_1 / in.N_HoursXDay(), slot_1 % in.N_HoursXDay());
+      other_hours = out.ProfMask(prof) & ~out.ClassSubjectMask(c, in.ProfSubject(prof));
+
+      if (other_hours != 0)
+      {
+        mv.class_1 = c;
+        mv.day_1 = slot_1 / in.N_HoursXDay();
+        mv.hour_1 = slot_1 % in.N_HoursXDay();
+        mv.day_2 = countr_zero(other_hours) / in.N_HoursXDay();
+        mv.hour_2 = countr_zero(other_hours) % in.N_HoursXDay();
+        mv.class_2 = out.Prof_Schedule(prof, mv.day_2, mv.hour_2);
+        return true;
+      }
+    }
+
+    return false;
+  }
+}
+
+/***************************************************************************
+ * Moves Code
+ ***************************************************************************/
+
+Sched_CrossSwapHours::Sched_CrossSwapHours()
+{
+  class_1 = -1;
+  class_2 = -1;
+  day_1 = -1;
+  hour_1 = -1;
+  day_2 = -1;
+  hour_2 = -1;
+}
+
+bool operator==(const Sched_CrossSwapHours& mv1, const Sched_CrossSwapHours& mv2)
+{
+  return mv1.class_1 == mv2.class_1 && mv1.class_2 == mv2.class_2 && mv1.day_1 == mv2.day_1 && mv1.hour_1 == mv2.hour_1 && mv1.day_2 == mv2.day_2 && mv1.hour_2 == mv2.hour_2;
+}
+
+bool operator!=(const Sched_CrossSwapHours& mv1, const Sched_CrossSwapHours& mv2)
+{
+  return !(mv1 == mv2);
+}
+
+bool operator<(const Sched_CrossSwapHours& mv1, const Sched_CrossSwapHours& mv2)
+{
+  if (mv1.class_1 != mv2.class_1)
+    return mv1.class_1 < mv2.class_1;
+  else if (mv1.class_2 != mv2.class_2)
+    return mv1.class_2 < mv2.class_2;
+  else if (mv1.day_1 != mv2.day_1)
+    return mv1.day_1 < mv2.day_1;
+  else if (mv1.hour_1 != mv2.hour_1)
+    return mv1.hour_1 < mv2.hour_1;
+  else if (mv1.day_2 != mv2.day_2)
+    return mv1.day_2 < mv2.day_2;
+  else
+    return mv1.hour_2 < mv2.hour_2;
+}
+
+istream& operator>>(istream& is, Sched_CrossSwapHours& mv)
+{
+  char ch;
+  is >> mv.class_1 >> ch >> mv.class_2 >> ch >> ch >> mv.day_1 >> ch >> mv.hour_1 >> ch >> ch >> ch >> ch >> ch >> mv.day_2 >> ch >> mv.hour_2 >> ch;
+  return is;
+}
+
+ostream& operator<<(ostream& os, const Sched_CrossSwapHours& mv)
+{
+  os << mv.class_1 << "," << mv.class_2 << ": (" << mv.day_1 << ", " << mv.hour_1 << ") <-> (" << mv.day_2 << ", " << mv.hour_2 << ")";
+  return os;
+}
+
+/***************************************************************************
+ * Sched_CrossSwapHours Neighborhood Explorer Code
+ ***************************************************************************/
+
+void Sched_CrossSwapHours_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sched_CrossSwapHours& mv) const
+{
+  SCHED_PROFILE(CROSS_SWAP_HOURS, RANDOM_MOVE);
+
+  unsigned max_iterations = 10 * in.N_Classes() * in.N_Days() * in.N_HoursXDay();
+  unsigned iterations;
+  uint64_t hours, other_hours;
+  unsigned c, slot_1, slot_2;
+  int prof;
+
+  if (in.N_Classes() < 2)  // There is only one class => no cross swap exists
+    throw EmptyNeighborhood();
+
+  // Draws an hour of a class and another hour of its professor with a different class, then puts the move in canonical form
+  for (iterations = 0; iterations < max_iterations; iterations++)
+  {
+    c = Sched_Random::Uniform<unsigned>(0, in.N_Classes() - 1);
+    hours = out.ClassMask(c);
+    if (hours == 0)
+      continue;
+
+    slot_1 = Sched_Output::NthHour(hours, Sched_Random::Uniform<unsigned>(0, popcount(hours) - 1));
+    prof = out.Class_Schedule(c, slot_1 / in.N_HoursXDay(), slot_1 % in.N_HoursXDay());
+    other_hours = out.ProfMask(prof) & ~out.ClassSubjectMask(c, in.ProfSubject(prof));
+    if (other_hours == 0)
+      continue;
+
+    slot_2 = Sched_Output::NthHour(other_hours, Sched_Random::Uniform<unsigned>(0, popcount(other_hours) - 1));
+
+    mv.class_1 = c;
+    mv.class_2 = out.Prof_Schedule(prof, slot_2 / in.N_HoursXDay(), slot_2 % in.N_HoursXDay());
+    if (mv.class_1 > mv.class_2)
+    {
+      swap(mv.class_1, mv.class_2);
+      swap(slot_1, slot_2);
+    }
+
+    // Both professors of the two hours teach in both classes: the move is the same read from either hour
+    if (slot_1 > slot_2 && out.Class_Schedule(mv.class_1, slot_2 / in.N_HoursXDay(), slot_2 % in.N_HoursXDay()) != -1
+        && out.Class_Schedule(mv.class_1, slot_2 / in.N_HoursXDay(), slot_2 % in.N_HoursXDay()) == out.Class_Schedule(mv.class_2, slot_1 / in.N_HoursXDay(), slot_1 % in.N_HoursXDay()))
+      swap(slot_1, slot_2);
+
+    mv.day_1 = slot_1 / in.N_HoursXDay();
+    mv.hour_1 = slot_1 % in.N_HoursXDay();
+    mv.day_2 = slot_2 / in.N_HoursXDay();
+    mv.hour_2 = slot_2 % in.N_HoursXDay();
+
+    if (FeasibleMove(out, mv))
+      return;
+  }
+
+  throw EmptyNeighborhood();
+}
+
+bool Sched_CrossSwapHours_NeighborhoodExplorer::FeasibleMove(const Sched_Output& out, const Sched_CrossSwapHours& mv) const
+{
+  SCHED_PROFILE(CROSS_SWAP_HOURS, FEASIBLE_MOVE);
+
+  int prof, other_1, other_2;
+
+  if (mv.class_1 >= mv.class_2 || (mv.day_1 == mv.day_2 && mv.hour_1 == mv.hour_2))
+    SCHED_PROFILE_RETURN(false);
+
+  // The professor of class_1 at hour 1 must be the one of class_2 at hour 2 (otherwise the move is made of two
+  // independent SwapHours moves)
+  prof = out.Class_Schedule(mv.class_1, mv.day_1, mv.hour_1);
+  if (prof == -1 || prof != out.Class_Schedule(mv.class_2, mv.day_2, mv.hour_2))
+    SCHED_PROFILE_RETURN(false);
+
+  // The lessons (or free hours) the professor leaves
+  other_1 = out.Class_Schedule(mv.class_1, mv.day_2, mv.hour_2);
+  other_2 = out.Class_Schedule(mv.class_2, mv.day_1, mv.hour_1);
+
+  // Canonical form: if other_1 also teaches in both classes, the move is read from the first hour
+  if (other_1 != -1 && other_1 == other_2 && (mv.day_1 > mv.day_2 || (mv.day_1 == mv.day_2 && mv.hour_1 > mv.hour_2)))
+    SCHED_PROFILE_RETURN(false);
+
+  // The professor keeps his two hours, the other two professors must be free in the new hour (apart from the
+  // lesson of the other class, that moves as well)
+  if ((other_1 != -1 && other_1 != other_2 && !out.IsProfHourFree(other_1, mv.day_1, mv.hour_1))
+   || (other_2 != -1 && other_2 != other_1 && !out.IsProfHourFree(other_2, mv.day_2, mv.hour_2)))
+    SCHED_PROFILE_RETURN(false);
+
+  SCHED_PROFILE_RETURN(true);
+}
+
+void Sched_CrossSwapHours_NeighborhoodExplorer::MakeMove(Sched_Output& out, const Sched_CrossSwapHours& mv) const
+{
+  SCHED_PROFILE(CROSS_SWAP_HOURS, MAKE_MOVE);
+
+  out.SwapHoursInClasses({(unsigned)mv.class_1, (unsigned)mv.class_2}, mv.day_1, mv.hour_1, mv.day_2, mv.hour_2);
+}
+
+void Sched_CrossSwapHours_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sched_CrossSwapHours& mv) const
+{
+  unsigned c;
+
+  for (c = 0; c < in.N_Classes(); c++)
+    if (FirstMoveInBlock(out, mv, c))
+      return;
+
+  throw EmptyNeighborhood();
+}
+
+bool Sched_CrossSwapHours_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sched_CrossSwapHours& mv) const
+{
+  SCHED_PROFILE(CROSS_SWAP_HOURS, NEXT_MOVE);
+
+  do
+  {
+    if (!AnyNextMove(out, mv))
+      return false;
+  } while (!FeasibleMove(out, mv));
+
+  return true;
+}
+
+bool Sched_CrossSwapHours_NeighborhoodExplorer::FirstMoveInBlock(const Sched_Output& out, Sched_CrossSwapHours& mv, unsigned b) const
+{
+  SCHED_PROFILE(CROSS_SWAP_HOURS, FIRST_MOVE_IN_BLOCK);
+
+  if (!FirstHoursPair(in, out, mv, b, 0))
+    return false;
+
+  while (!FeasibleMove(out, mv))
+  {
+    if (!AnyNextMove(out, mv) || mv.class_1 != (int)b)
+      return false;
+  }
+
+  return true;
+}
+
+bool Sched_CrossSwapHours_NeighborhoodExplorer::NextMoveInBlock(const Sched_Output& out, Sched_CrossSwapHours& mv) const
+{
+  SCHED_PROFILE(CROSS_SWAP_HOURS, NEXT_MOVE_IN_BLOCK);
+
+  int b = mv.class_1;
+
+  do
+  {
+    if (!AnyNextMove(out, mv) || mv.class_1 != b)
+      return false;
+  } while (!FeasibleMove(out, mv));
+
+  return true;
+}
+
+// The moves are enumerated by class_1, hour of class_1 and hour of its professor with another class
+bool Sched_CrossSwapHours_NeighborhoodExplorer::AnyNextMove(const Sched_Output& out, Sched_CrossSwapHours& mv) const
+{
+  unsigned slot_1 = mv.day_1 * in.N_HoursXDay() + mv.hour_1;
+  unsigned slot_2 = mv.day_2 * in.N_HoursXDay() + mv.hour_2;
+  int prof = out.Class_Schedule(mv.class_1, mv.day_1, mv.hour_1);
+  uint64_t other_hours;
+  unsigned c;
+
+  // Next hour of the professor
+  other_hours = slot_2 < 63 ? out.ProfMask(prof) & ~out.ClassSubjectMask(mv.class_1, in.ProfSubject(prof)) & (~(uint64_t)0 << (slot_2 + 1)) : 0;
+  if (other_hours != 0)
+  {
+    mv.day_2 = countr_zero(other_hours) / in.N_HoursXDay();
+    mv.hour_2 = countr_zero(other_hours) % in.N_HoursXDay();
+    mv.class_2 = out.Prof_Schedule(prof, mv.day_2, mv.hour_2);
+    return true;
+  }
+
+  // Next hour of class_1, then next class
+  if (FirstHoursPair(in, out, mv, mv.class_1, slot_1 + 1))
+    return true;
+
+  for (c = mv.class_1 + 1; c < in.N_Classes(); c++)
+    if (FirstHoursPair(in, out, mv, c, 0))
+      return true;
+
+  return false;
+}
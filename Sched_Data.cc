@@ -2,50 +2,342 @@
 #include "Sched_Data.hh"
 #include <fstream>
 #include <iomanip>
+#include <atomic>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <string_view>
+#include <charconv>
+
+namespace
+{
+  atomic<uint64_t> version_blocks(0);
+
+  // New version for a Sched_Output: versions are taken from blocks reserved by each thread,
+  // so that chains running in parallel do not contend on the shared counter
+  uint64_t NewVersion()
+  {
+    const uint64_t block_size = (uint64_t)1 << 20;
+    thread_local uint64_t next = 0, end = 0;
+
+    if (next == end)
+    {
+      next = version_blocks.fetch_add(1) * block_size;
+      end = next + block_size;
+    }
+    return next++;
+  }
+
+  // 64 bit FNV-1a style hash on 8 byte words (then on the remaining bytes), continued from hash
+  uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t word;
+    size_t i;
+
+    for (i = 0; i + sizeof(word) <= size; i += sizeof(word))
+    {
+      memcpy(&word, bytes + i, sizeof(word));
+      hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < size; i++)
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+  }
+
+  // Snapshot layout: the header, then the payload (the tables of Sched_Output in ForEachTable order, each as its
+  // raw cells, followed by the four violation/open class totals as uint32)
+  struct SnapshotHeader
+  {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;   // 0x01020304 as stored by the writer
+    uint64_t instance_fingerprint;
+    uint32_t n_classes, n_days, n_hours_x_day, n_subjects, n_profs, reserved;
+    uint64_t payload_size;
+    uint64_t payload_checksum;
+  };
+
+  const char snapshot_magic[8] = {'S', 'C', 'H', 'E', 'D', 'S', 'N', 'P'};
+  const uint32_t snapshot_format_version = 1;
+
+  SnapshotHeader InstanceSnapshotHeader(const Sched_Input& in)
+  {
+    SnapshotHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.format_version = snapshot_format_version;
+    header.byte_order = 0x01020304;
+    header.instance_fingerprint = in.Fingerprint();
+    header.n_classes = in.N_Classes();
+    header.n_days = in.N_Days();
+    header.n_hours_x_day = in.N_HoursXDay();
+    header.n_subjects = in.N_Subjects();
+    header.n_profs = in.N_Profs();
+    return header;
+  }
+
+  // Read-only memory mapping of a whole file
+  class MappedFile
+  {
+  public:
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile()
+    {
+      if (data != nullptr)
+        munmap(data, size);
+    }
+    bool Open(const string& filename)
+    {
+      struct stat file_stat;
+      int fd = open(filename.c_str(), O_RDONLY);
+
+      if (fd < 0)
+        return false;
+      if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+      {
+        close(fd);
+        return false;
+      }
+      data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED)
+      {
+        data = nullptr;
+        return false;
+      }
+      size = file_stat.st_size;
+      return true;
+    }
+    const char* Data() const { return static_cast<const char*>(data); }
+    size_t Size() const { return size; }
+  private:
+    void* data;
+    size_t size;
+  };
+
+  // Same set as isspace in the C locale, without the locale lookup
+  inline bool IsSpace(char c)
+  {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  // Whitespace-separated tokens of a buffer
+  class Tokenizer
+  {
+  public:
+    Tokenizer(const char* buffer, size_t size) : position(buffer), end(buffer + size) {}
+    bool Next(string_view& token)
+    {
+      const char* start;
+
+      while (position != end && IsSpace(*position))
+        position++;
+      if (position == end)
+        return false;
+      start = position;
+      while (position != end && !IsSpace(*position))
+        position++;
+      token = string_view(start, position - start);
+      return true;
+    }
+    string_view Word()
+    {
+      string_view token;
+
+      if (!Next(token))
+      {
+        cerr << "Unexpected end of input file" << endl;
+        exit(1);
+      }
+      return token;
+    }
+    unsigned Unsigned()
+    {
+      string_view token = Word();
+      unsigned value = 0;
+      from_chars_result result = from_chars(token.data(), token.data() + token.size(), value);
+
+      // an out of range number is matched to its end as well, only ec tells it
+      if (result.ec != errc() || result.ptr != token.data() + token.size())
+      {
+        cerr << "Bad number " << token << " in input file" << endl;
+        exit(1);
+      }
+      return value;
+    }
+  private:
+    const char* position;
+    const char* end;
+  };
+
+  int64_t FileTime(const struct stat& file_stat)
+  {
+    return (int64_t)file_stat.st_mtim.tv_sec * 1000000000 + file_stat.st_mtim.tv_nsec;
+  }
+
+  // Compiled instance cache (.schedbin) header: the size and modification time of the text file it has been
+  // compiled from, and the checksum of the payload
+  struct InstanceCacheHeader
+  {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    uint64_t source_size;
+    int64_t source_time;   // ns
+    uint64_t payload_size;
+    uint64_t payload_checksum;
+  };
+
+  const char instance_cache_magic[8] = {'S', 'C', 'H', 'E', 'D', 'B', 'I', 'N'};
+  const uint32_t instance_cache_format_version = 1;
+
+  class CacheWriter
+  {
+  public:
+    void Write(unsigned value) { payload.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void Write(const vector<unsigned>& values)
+    {
+      Write((unsigned)values.size());
+      payload.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(unsigned));
+    }
+    void Write(const vector<string>& names)
+    {
+      Write((unsigned)names.size());
+      for (const string& name : names)
+      {
+        Write((unsigned)name.size());
+        payload.append(name);
+      }
+    }
+    const string& Payload() const { return payload; }
+  private:
+    string payload;
+  };
+
+  // Reads what CacheWriter wrote, Complete() is false if the payload is too short or too long
+  class CacheReader
+  {
+  public:
+    CacheReader(const char* buffer, size_t size) : position(buffer), end(buffer + size), valid(true) {}
+    void Read(unsigned& value)
+    {
+      if (!Available(sizeof(value)))
+        return;
+      memcpy(&value, position, sizeof(value));
+      position += sizeof(value);
+    }
+    void Read(vector<unsigned>& values)
+    {
+      unsigned n = 0;
+
+      Read(n);
+      if (!Available((size_t)n * sizeof(unsigned)))
+        return;
+      values.resize(n);
+      memcpy(values.data(), position, (size_t)n * sizeof(unsigned));
+      position += (size_t)n * sizeof(unsigned);
+    }
+    void Read(vector<string>& names)
+    {
+      unsigned n = 0, length, i;
+
+      Read(n);
+      if (!Available(n))   // every name takes at least its length
+        return;
+      names.resize(n);
+      for (i = 0; i < n; i++)
+      {
+        length = 0;
+        Read(length);
+        if (!Available(length))
+          return;
+        names[i].assign(position, length);
+        position += length;
+      }
+    }
+    bool Complete() const { return valid && position == end; }
+  private:
+    bool Available(size_t size)
+    {
+      if (!valid || (size_t)(end - position) < size)
+        valid = false;
+      return valid;
+    }
+    const char* position;
+    const char* end;
+    bool valid;
+  };
+}
 
-Sched_Input::Sched_Input(string input_filename)
-  : subject_max_hours_x_day(0),
+Sched_Input::Sched_Input(string input_filename, bool use_cache)
+  : n_days(0),
+    n_hours_x_day(0),
+    n_subjects(0),
+    n_profs(0),
+    n_classes(0),
+    subject_max_hours_x_day(0),
     max_prof_weekly_hours(0),
     unavailability_violation_cost(0),
     max_subject_hours_x_day_violation_cost(0),
     max_prof_weekly_hours_violation_cost(0),
     schedule_contiguity_violation_cost(0)
-{  
-  unsigned input_unsigned;
+{
+  MappedFile file;
+  struct stat source_stat;
+  string cache_filename = input_filename + ".schedbin";
   unsigned i;
-  string input_buffer;
 
   // Open input file
-  ifstream is(input_filename);
-  if(!is)
+  if (!file.Open(input_filename) || stat(input_filename.c_str(), &source_stat) != 0)
   {
     cerr << "Cannot open input file " << input_filename << endl;
     exit(1);
   }
-  
-
-  is >> input_buffer;
-  while (!is.eof() && input_buffer[0] == '$')
-  {
-    if (input_buffer == "$orario")
-    {
-      is >> input_buffer;
 
-      while (!is.eof() && input_buffer[0] != '$')
-      {
-        if (input_buffer == "Days")
-          is >> n_days;
+  // The cache is used if it has been compiled from the file as it is now (same size and modification time)
+  if (use_cache && ReadCache(cache_filename, source_stat.st_size, FileTime(source_stat)))
+    return;
 
-        if (input_buffer == "HoursXDay")
-          is >> n_hours_x_day;
+  Parse(file.Data(), file.Size());
 
-        if (input_buffer == "SubjectMaxHoursXDay")
-          is >> subject_max_hours_x_day;
+  profs_x_subject.resize(n_subjects, vector<unsigned>());
+  for (i = 0; i < n_profs; i++)
+    profs_x_subject[prof_subject[i]].push_back(i);
 
-        if (input_buffer == "ProfMaxWeeklyHours")
-          is >> max_prof_weekly_hours;
+  if (use_cache)
+    WriteCache(cache_filename, source_stat.st_size, FileTime(source_stat));
+}
 
-        is >> input_buffer;
+// Tokens are whitespace-separated views of the mapped file, subjects and days are resolved through hash maps
+void Sched_Input::Parse(const char* buffer, size_t size)
+{
+  static const unordered_map<string_view, days> day_index = {{"lun", lun}, {"mar", mar}, {"mer", mer}, {"gio", gio},
+                                                            {"ven", ven}, {"sab", sab}, {"dom", dom}};
+  unordered_map<string_view, unsigned> subject_index;
+  Tokenizer tokens(buffer, size);
+  string_view token;
+  bool more;
+
+  more = tokens.Next(token);
+  while (more && token[0] == '$')
+  {
+    if (token == "$orario")
+    {
+      while ((more = tokens.Next(token)) && token[0] != '$')
+      {
+        if (token == "Days")
+          n_days = tokens.Unsigned();
+        else if (token == "HoursXDay")
+          n_hours_x_day = tokens.Unsigned();
+        else if (token == "SubjectMaxHoursXDay")
+          subject_max_hours_x_day = tokens.Unsigned();
+        else if (token == "ProfMaxWeeklyHours")
+          max_prof_weekly_hours = tokens.Unsigned();
       }
 
       // If SubjectMaxHoursXDay not specified, that limit is disabled
@@ -60,112 +352,62 @@ Sched_Input::Sched_Input(string input_filename)
         max_prof_weekly_hours = n_hours_x_day * n_days;
       }
     }
-    else if (input_buffer == "$materie")
+    else if (token == "$materie")
     {
-      is >> input_buffer;
-
-      while (!is.eof() && input_buffer[0] != '$')
+      while ((more = tokens.Next(token)) && token[0] != '$')
       {
-        subject_name.push_back(input_buffer);
-
-        is >> input_unsigned;
-        n_hours_x_subject.push_back(input_unsigned);
-
-        is >> input_buffer;
+        subject_index.emplace(token, subject_name.size());  // a repeated name keeps its first index
+        subject_name.emplace_back(token);
+        n_hours_x_subject.push_back(tokens.Unsigned());
       }
 
       n_subjects = subject_name.size();
-
     }
-    else if (input_buffer == "$professori")
+    else if (token == "$professori")
     {
-      is >> input_buffer;
-
-      while (!is.eof() && input_buffer[0] != '$')
+      while ((more = tokens.Next(token)) && token[0] != '$')
       {
-        prof_name.push_back(input_buffer);
-
-        is >> input_buffer;
-        
-        i = 0;
-        while (i < n_subjects && subject_name[i] != input_buffer)
-          i++;
+        prof_name.emplace_back(token);
 
-        if(i == n_subjects)
+        auto subject = subject_index.find(tokens.Word());
+        if (subject == subject_index.end())
         { 
           cerr << "Inexistent subject" << endl;
           exit(1);
         }
+        prof_subject.push_back(subject->second);
 
-        prof_subject.push_back(i);
-
-        is >> input_buffer;
-
-        if (input_buffer == "lun")
-          prof_unavailability.push_back(lun);
-        else if (input_buffer == "mar")
-          prof_unavailability.push_back(mar);
-        else if (input_buffer == "mer")
-          prof_unavailability.push_back(mer);
-        else if (input_buffer == "gio")
-          prof_unavailability.push_back(gio);
-        else if (input_buffer == "ven")
-          prof_unavailability.push_back(ven);
-        else if (input_buffer == "sab")
-          prof_unavailability.push_back(sab);
-        else if (input_buffer == "dom")
-          prof_unavailability.push_back(dom);
-        else
+        auto day = day_index.find(tokens.Word());
+        if (day == day_index.end())
         {
           cerr << "Inexistent day of week" << endl;
           exit(1);
         }
-
-        is >> input_buffer;
+        prof_unavailability.push_back(day->second);
       }
 
       n_profs = prof_name.size();
-
-      profs_x_subject.resize(n_subjects, vector<unsigned>());
-
-      for (i = 0; i < n_profs; i++)
-        profs_x_subject[prof_subject[i]].push_back(i);
-
     }
-    else if (input_buffer == "$classi")
+    else if (token == "$classi")
     {
-      is >> input_buffer;
-
-      while (!is.eof() && input_buffer[0] != '$')
-      {
-        class_name.push_back(input_buffer);
-
-        is >> input_buffer;
-      }
+      while ((more = tokens.Next(token)) && token[0] != '$')
+        class_name.emplace_back(token);
 
       n_classes = class_name.size();
     }
-    else if (input_buffer == "$costi")
+    else if (token == "$costi")
     {
-      is >> input_buffer;
-
-      while (!is.eof() && input_buffer[0] != '$')
+      while ((more = tokens.Next(token)) && token[0] != '$')
       {
-        if (input_buffer == "UnavailabilityViolation")
-          is >> unavailability_violation_cost;
-
-        if (input_buffer == "MaxSubjectHoursXDayViolation")
-          is >> max_subject_hours_x_day_violation_cost;
-
-        if (input_buffer == "MaxProfWeeklyHoursViolation")
-          is >> max_prof_weekly_hours_violation_cost;
-
-        if (input_buffer == "ScheduleContiguityViolation")
-          is >> schedule_contiguity_violation_cost;
-
-        is >> input_buffer;
+        if (token == "UnavailabilityViolation")
+          unavailability_violation_cost = tokens.Unsigned();
+        else if (token == "MaxSubjectHoursXDayViolation")
+          max_subject_hours_x_day_violation_cost = tokens.Unsigned();
+        else if (token == "MaxProfWeeklyHoursViolation")
+          max_prof_weekly_hours_violation_cost = tokens.Unsigned();
+        else if (token == "ScheduleContiguityViolation")
+          schedule_contiguity_violation_cost = tokens.Unsigned();
       }
-
     }
     else
     {
@@ -175,6 +417,101 @@ Sched_Input::Sched_Input(string input_filename)
   }
 }
 
+// Cache layout: the header, then the scalars and the tables of the instance (each table preceded by its size,
+// each name by its length); profs_x_subject is rebuilt
+bool Sched_Input::ReadCache(const string& cache_filename, uint64_t source_size, int64_t source_time)
+{
+  MappedFile file;
+  InstanceCacheHeader header;
+  unsigned i;
+
+  if (!file.Open(cache_filename) || file.Size() < sizeof(header))
+    return false;
+  memcpy(&header, file.Data(), sizeof(header));
+  if (memcmp(header.magic, instance_cache_magic, sizeof(instance_cache_magic)) != 0 || header.format_version != instance_cache_format_version
+      || header.byte_order != 0x01020304 || header.source_size != source_size || header.source_time != source_time
+      || header.payload_size != file.Size() - sizeof(header)
+      || Hash(file.Data() + sizeof(header), header.payload_size) != header.payload_checksum)
+    return false;
+
+  CacheReader reader(file.Data() + sizeof(header), header.payload_size);
+  reader.Read(n_days);
+  reader.Read(n_hours_x_day);
+  reader.Read(subject_max_hours_x_day);
+  reader.Read(max_prof_weekly_hours);
+  reader.Read(unavailability_violation_cost);
+  reader.Read(max_subject_hours_x_day_violation_cost);
+  reader.Read(max_prof_weekly_hours_violation_cost);
+  reader.Read(schedule_contiguity_violation_cost);
+  reader.Read(subject_name);
+  reader.Read(n_hours_x_subject);
+  reader.Read(prof_name);
+  reader.Read(prof_subject);
+  reader.Read(prof_unavailability);
+  reader.Read(class_name);
+
+  n_subjects = subject_name.size();
+  n_profs = prof_name.size();
+  n_classes = class_name.size();
+  if (!reader.Complete() || n_hours_x_subject.size() != n_subjects || prof_subject.size() != n_profs || prof_unavailability.size() != n_profs
+      || any_of(prof_subject.begin(), prof_subject.end(), [this](unsigned s) { return s >= n_subjects; }))
+  {
+    subject_name.clear();
+    n_hours_x_subject.clear();
+    prof_name.clear();
+    prof_subject.clear();
+    prof_unavailability.clear();
+    class_name.clear();
+    return false;
+  }
+
+  profs_x_subject.resize(n_subjects, vector<unsigned>());
+  for (i = 0; i < n_profs; i++)
+    profs_x_subject[prof_subject[i]].push_back(i);
+
+  return true;
+}
+
+// The cache is written to a temporary file and renamed, so that concurrent runs never read a partial cache;
+// a cache that cannot be written is simply not used
+void Sched_Input::WriteCache(const string& cache_filename, uint64_t source_size, int64_t source_time) const
+{
+  InstanceCacheHeader header;
+  CacheWriter writer;
+  string temporary_filename = cache_filename + ".tmp" + to_string(getpid());
+
+  writer.Write(n_days);
+  writer.Write(n_hours_x_day);
+  writer.Write(subject_max_hours_x_day);
+  writer.Write(max_prof_weekly_hours);
+  writer.Write(unavailability_violation_cost);
+  writer.Write(max_subject_hours_x_day_violation_cost);
+  writer.Write(max_prof_weekly_hours_violation_cost);
+  writer.Write(schedule_contiguity_violation_cost);
+  writer.Write(subject_name);
+  writer.Write(n_hours_x_subject);
+  writer.Write(prof_name);
+  writer.Write(prof_subject);
+  writer.Write(prof_unavailability);
+  writer.Write(class_name);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, instance_cache_magic, sizeof(instance_cache_magic));
+  header.format_version = instance_cache_format_version;
+  header.byte_order = 0x01020304;
+  header.source_size = source_size;
+  header.source_time = source_time;
+  header.payload_size = writer.Payload().size();
+  header.payload_checksum = Hash(writer.Payload().data(), writer.Payload().size());
+
+  ofstream os(temporary_filename, ios::binary);
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  os.write(writer.Payload().data(), writer.Payload().size());
+  os.close();
+  if (!os || rename(temporary_filename.c_str(), cache_filename.c_str()) != 0)
+    remove(temporary_filename.c_str());
+}
+
 ostream& operator<<(ostream& os, const Sched_Input& in)
 {
   unsigned i;
@@ -371,6 +708,27 @@ void Sched_Input::Print(ostream& os) const
   os << "----------------------" << endl;
 }
 
+uint64_t Sched_Input::Fingerprint() const
+{
+  unsigned values[] = {n_days, n_hours_x_day, n_subjects, n_profs, n_classes, subject_max_hours_x_day, max_prof_weekly_hours,
+                       unavailability_violation_cost, max_subject_hours_x_day_violation_cost, max_prof_weekly_hours_violation_cost,
+                       schedule_contiguity_violation_cost};
+  uint64_t hash = Hash(values, sizeof(values));
+  unsigned i;
+
+  hash = Hash(n_hours_x_subject.data(), n_hours_x_subject.size() * sizeof(unsigned), hash);
+  hash = Hash(prof_subject.data(), prof_subject.size() * sizeof(unsigned), hash);
+  hash = Hash(prof_unavailability.data(), prof_unavailability.size() * sizeof(unsigned), hash);
+  for (i = 0; i < n_subjects; i++)
+    hash = Hash(subject_name[i].c_str(), subject_name[i].size() + 1, hash);
+  for (i = 0; i < n_profs; i++)
+    hash = Hash(prof_name[i].c_str(), prof_name[i].size() + 1, hash);
+  for (i = 0; i < n_classes; i++)
+    hash = Hash(class_name[i].c_str(), class_name[i].size() + 1, hash);
+
+  return hash;
+}
+
 bool operator==(const Sched_Output& out1, const Sched_Output& out2)
 {
   if (
@@ -378,10 +736,21 @@ bool operator==(const Sched_Output& out1, const Sched_Output& out2)
     out1.class_profs == out2.class_profs &&
     out1.daily_subject_assigned_hours == out2.daily_subject_assigned_hours &&
     out1.weekly_subject_assigned_hours == out2.weekly_subject_assigned_hours &&
+    out1.class_mask == out2.class_mask &&
+    out1.class_subject_mask == out2.class_subject_mask &&
+    out1.class_open_subjects == out2.class_open_subjects &&
+    out1.class_candidate_profs == out2.class_candidate_profs &&
 
     out1.schedule_prof == out2.schedule_prof &&
     out1.prof_weekly_hours == out2.prof_weekly_hours &&
-    out1.prof_day_off == out2.prof_day_off)
+    out1.prof_daily_hours == out2.prof_daily_hours &&
+    out1.prof_free_days == out2.prof_free_days &&
+    out1.prof_day_off == out2.prof_day_off &&
+    out1.prof_mask == out2.prof_mask &&
+
+    out1.contiguity_violations == out2.contiguity_violations &&
+    out1.max_subject_hours_x_day_violations == out2.max_subject_hours_x_day_violations &&
+    out1.free_class_hours == out2.free_class_hours)
   {
     return true;
   }
@@ -391,17 +760,37 @@ bool operator==(const Sched_Output& out1, const Sched_Output& out2)
 
 Sched_Output::Sched_Output(const Sched_Input& my_in)
   : in(my_in),
-  schedule_class(in.N_Classes(), vector(in.N_Days(), vector<int>(in.N_HoursXDay(), -1))),
-  class_profs(in.N_Classes(), vector<int>(in.N_Subjects(), -1)),
-  daily_subject_assigned_hours(in.N_Classes(), vector(in.N_Days(), vector<unsigned>(in.N_Subjects(), 0))),
-  weekly_subject_assigned_hours(in.N_Classes(), vector<unsigned>(in.N_Subjects(), 0)),
-
-  schedule_prof(in.N_Profs(), vector(in.N_Days(), vector<int>(in.N_HoursXDay(), -1))),
+  schedule_class(in.N_Classes() * in.N_Days() * in.N_HoursXDay(), -1),
+  class_profs(in.N_Classes() * in.N_Subjects(), -1),
+  daily_subject_assigned_hours(in.N_Classes() * in.N_Days() * in.N_Subjects(), 0),
+  weekly_subject_assigned_hours(in.N_Classes() * in.N_Subjects(), 0),
+  class_mask(in.N_Classes(), 0),
+  class_subject_mask(in.N_Classes() * in.N_Subjects(), 0),
+  class_open_subjects(in.N_Classes()),
+  class_candidate_profs(in.N_Classes()),
+  open_classes(in.N_Classes()),
+  open_class_position(in.N_Classes()),
+
+  schedule_prof(in.N_Profs() * in.N_Days() * in.N_HoursXDay(), -1),
   prof_weekly_hours(in.N_Profs(), 0),
-  prof_day_off(in.N_Profs())
+  prof_daily_hours(in.N_Profs() * in.N_Days(), 0),
+  prof_free_days(in.N_Profs(), in.N_Days()),
+  prof_day_off(in.N_Profs()),
+  prof_mask(in.N_Profs(), 0)
 {
+  // Cells are stored in small integer types, a whole week and all the subjects in 64 bit masks: check that the instance fits
+  // (and that a day has hours, the day and week masks shift by 64 - hours)
+  if (in.N_Days() == 0 || in.N_HoursXDay() == 0)
+    throw runtime_error("Instance without days or hours per day.");
+  if (in.N_Profs() > INT16_MAX || in.N_Classes() > INT16_MAX || in.N_Days() * in.N_HoursXDay() > 64 || in.N_Subjects() > 64)
+    throw runtime_error("Instance too large for Sched_Output tables.");
+
   for (unsigned i = 0; i < in.N_Profs(); i++)
     prof_day_off[i] = (int)in.ProfUnavailability(i);
+
+  ResetCandidateProfs();
+  ResetViolationTotals();
+  version = NewVersion();
 }
 
 Sched_Output& Sched_Output::operator=(const Sched_Output& out)
@@ -409,52 +798,135 @@ Sched_Output& Sched_Output::operator=(const Sched_Output& out)
   if (&in != &out.in)
     throw runtime_error("Impossible Sched_Output assignation. The field 'const Sched_Input& in' is different.");
 
+  // Tables have the same size in both states, so each assignment is a plain copy of the buffer (no reallocation)
   schedule_class = out.schedule_class;
   daily_subject_assigned_hours = out.daily_subject_assigned_hours;
   weekly_subject_assigned_hours = out.weekly_subject_assigned_hours;
   class_profs = out.class_profs;
+  class_mask = out.class_mask;
+  class_subject_mask = out.class_subject_mask;
+  class_open_subjects = out.class_open_subjects;
+  class_candidate_profs = out.class_candidate_profs;
+  open_classes = out.open_classes;
+  open_class_position = out.open_class_position;
+  n_open_classes = out.n_open_classes;
   
   schedule_prof = out.schedule_prof;
   prof_weekly_hours = out.prof_weekly_hours;
+  prof_daily_hours = out.prof_daily_hours;
+  prof_free_days = out.prof_free_days;
   prof_day_off = out.prof_day_off;
+  prof_mask = out.prof_mask;
+
+  contiguity_violations = out.contiguity_violations;
+  max_subject_hours_x_day_violations = out.max_subject_hours_x_day_violations;
+  free_class_hours = out.free_class_hours;
+  version = out.version;
 
   return *this;
 }
 
 void Sched_Output::Reset()
 {
-  unsigned c, p, s, d, h;
+  unsigned p;
+
+  fill(schedule_class.begin(), schedule_class.end(), -1);
+  fill(daily_subject_assigned_hours.begin(), daily_subject_assigned_hours.end(), 0);
+  fill(class_profs.begin(), class_profs.end(), -1);
+  fill(weekly_subject_assigned_hours.begin(), weekly_subject_assigned_hours.end(), 0);
+  fill(class_mask.begin(), class_mask.end(), 0);
+  fill(class_subject_mask.begin(), class_subject_mask.end(), 0);
+
+  fill(schedule_prof.begin(), schedule_prof.end(), -1);
+  fill(prof_weekly_hours.begin(), prof_weekly_hours.end(), 0);
+  fill(prof_daily_hours.begin(), prof_daily_hours.end(), 0);
+  fill(prof_free_days.begin(), prof_free_days.end(), in.N_Days());
+  fill(prof_mask.begin(), prof_mask.end(), 0);
+
+  for (p = 0; p < in.N_Profs(); p++)
+    prof_day_off[p] = (int)in.ProfUnavailability(p);
+
+  ResetCandidateProfs();
+  ResetViolationTotals();
+  version = NewVersion();
+}
+
+// Empty schedule: no gaps and no excess hours, every class hour is free
+void Sched_Output::ResetViolationTotals()
+{
+  contiguity_violations = 0;
+  max_subject_hours_x_day_violations = 0;
+  free_class_hours = in.N_Classes() * in.N_Days() * in.N_HoursXDay();
+}
+
+// Empty schedule: every subject with weekly hours is open and all of its profs are candidates
+void Sched_Output::ResetCandidateProfs()
+{
+  unsigned c, s;
+
+  n_open_classes = 0;
 
   for (c = 0; c < in.N_Classes(); c++)
   {
-    for (d = 0; d < in.N_Days(); d++)
-    {
-      for (h = 0; h < in.N_HoursXDay(); h++)
-        schedule_class[c][d][h] = -1;
+    class_open_subjects[c] = 0;
+    class_candidate_profs[c] = 0;
 
-      for (s = 0; s < in.N_Subjects(); s++)
+    for (s = 0; s < in.N_Subjects(); s++)
+      if (in.N_HoursXSubject(s) > 0)
       {
-        daily_subject_assigned_hours[c][d][s] = 0;
+        class_open_subjects[c] |= (uint64_t)1 << s;
+        class_candidate_profs[c] += in.N_ProfsXSubject(s);
       }
-    }
 
-    for (s = 0; s < in.N_Subjects(); s++)
+    if (class_candidate_profs[c] > 0)
     {
-      class_profs[c][s] = -1;
-      weekly_subject_assigned_hours[c][s] = 0;
+      open_class_position[c] = n_open_classes;
+      open_classes[n_open_classes++] = c;
     }
+    else
+      open_class_position[c] = -1;
   }
-    
+}
 
-  for (p = 0; p < in.N_Profs(); p++)
-  {
-    for (d = 0; d < in.N_Days(); d++)
-      for (h = 0; h < in.N_HoursXDay(); h++)
-        schedule_prof[p][d][h] = -1;
+// Number of candidate profs given by subject s to class c in the current schedule
+unsigned Sched_Output::SubjectCandidateProfs(unsigned c, unsigned s) const
+{
+  if (WeeklySubjectAssignedHours(c, s) >= in.N_HoursXSubject(s))
+    return 0;
+  else if (WeeklySubjectAssignedHours(c, s) > 0)
+    return 1;
+  else
+    return in.N_ProfsXSubject(s);
+}
 
-    prof_weekly_hours[p] = 0;
-    
-    prof_day_off[p] = (int)in.ProfUnavailability(p);
+// Called after the hours of subject s in class c have changed
+void Sched_Output::UpdateCandidateProfs(unsigned c, unsigned s, unsigned old_candidates)
+{
+  unsigned new_candidates = SubjectCandidateProfs(c, s);
+  unsigned last;
+
+  if (new_candidates == old_candidates)
+    return;
+
+  class_candidate_profs[c] += new_candidates - old_candidates;
+
+  if (new_candidates > 0)
+    class_open_subjects[c] |= (uint64_t)1 << s;
+  else
+    class_open_subjects[c] &= ~((uint64_t)1 << s);
+
+  if (class_candidate_profs[c] > 0 && open_class_position[c] == -1)
+  {
+    open_class_position[c] = n_open_classes;
+    open_classes[n_open_classes++] = c;
+  }
+  else if (class_candidate_profs[c] == 0 && open_class_position[c] != -1)
+  {
+    // Move the last open class into the slot of the closed one
+    last = open_classes[--n_open_classes];
+    open_classes[open_class_position[c]] = last;
+    open_class_position[last] = open_class_position[c];
+    open_class_position[c] = -1;
   }
 }
 
@@ -721,49 +1193,96 @@ void Sched_Output::PrintTAB(string output_filename) const
 
 void Sched_Output::AssignHour(unsigned c, unsigned d, unsigned h, unsigned p)
 {
+  unsigned s = in.ProfSubject(p);
+  unsigned old_candidates = SubjectCandidateProfs(c, s);
+  unsigned old_gaps = ClassSubjectDayGaps(c, d, s);
+
+  version = NewVersion();
+
   // the class "gains" a prof
-  class_profs[c][in.ProfSubject(p)] = p;
+  class_profs[ClassSubjectIndex(c, s)] = p;
 
   // Update prof weekly assigned hours
   prof_weekly_hours[p]++;
 
   // Assign hour to class and prof schedule
-  schedule_class[c][d][h] = p;
-  schedule_prof[p][d][h] = c;
+  schedule_class[ClassHourIndex(c, d, h)] = p;
+  schedule_prof[ProfHourIndex(p, d, h)] = c;
+
+  // Mark the hour as busy
+  class_mask[c] |= (uint64_t)1 << Slot(d, h);
+  class_subject_mask[ClassSubjectIndex(c, s)] |= (uint64_t)1 << Slot(d, h);
+  prof_mask[p] |= (uint64_t)1 << Slot(d, h);
 
   // Update Daily and weekly assigned hours
-  weekly_subject_assigned_hours[c][in.ProfSubject(p)]++;
-  daily_subject_assigned_hours[c][d][in.ProfSubject(p)]++;
+  weekly_subject_assigned_hours[ClassSubjectIndex(c, s)]++;
+  daily_subject_assigned_hours[ClassDaySubjectIndex(c, d, s)]++;
 
-  ComputeProfDayOff(p);
+  // Update violation totals
+  contiguity_violations += ClassSubjectDayGaps(c, d, s) - old_gaps;
+  if (daily_subject_assigned_hours[ClassDaySubjectIndex(c, d, s)] > in.SubjectMaxHoursXDay())
+    max_subject_hours_x_day_violations++;
+  free_class_hours--;
+
+  UpdateCandidateProfs(c, s, old_candidates);
+
+  // Update prof daily assigned hours: the day off changes only if the day was free
+  if (prof_daily_hours[ProfDayIndex(p, d)]++ == 0)
+  {
+    prof_free_days[p]--;
+    UpdateProfDayOff(p, d);
+  }
 }
 
 
 void Sched_Output::FreeHour(unsigned c, unsigned d, unsigned h)
 {
-  unsigned p;
+  unsigned p, s, old_candidates, old_gaps;
 
   p = (unsigned)Class_Schedule(c, d, h);
+  s = in.ProfSubject(p);
+  old_candidates = SubjectCandidateProfs(c, s);
+  old_gaps = ClassSubjectDayGaps(c, d, s);
+
+  version = NewVersion();
 
   // Frees hour from class and prof schedule
-  schedule_class[c][d][h] = -1;
-  schedule_prof[p][d][h] = -1;
+  schedule_class[ClassHourIndex(c, d, h)] = -1;
+  schedule_prof[ProfHourIndex(p, d, h)] = -1;
+
+  // Mark the hour as free
+  class_mask[c] &= ~((uint64_t)1 << Slot(d, h));
+  class_subject_mask[ClassSubjectIndex(c, s)] &= ~((uint64_t)1 << Slot(d, h));
+  prof_mask[p] &= ~((uint64_t)1 << Slot(d, h));
+
+  // Update violation totals
+  contiguity_violations -= old_gaps - ClassSubjectDayGaps(c, d, s);
+  if (daily_subject_assigned_hours[ClassDaySubjectIndex(c, d, s)] > in.SubjectMaxHoursXDay())
+    max_subject_hours_x_day_violations--;
+  free_class_hours++;
 
   // Update Daily and weekly assigned hours
-  weekly_subject_assigned_hours[c][in.ProfSubject(p)]--;
-  daily_subject_assigned_hours[c][d][in.ProfSubject(p)]--;
+  weekly_subject_assigned_hours[ClassSubjectIndex(c, s)]--;
+  daily_subject_assigned_hours[ClassDaySubjectIndex(c, d, s)]--;
 
   // Update prof weekly assigned hours
   prof_weekly_hours[p]--;
 
   // If there are no more assigned hours of a specific subject
   // the class "loses" a prof
-  if (weekly_subject_assigned_hours[c][in.ProfSubject(p)] == 0)
+  if (weekly_subject_assigned_hours[ClassSubjectIndex(c, s)] == 0)
   {
-    class_profs[c][in.ProfSubject(p)] = -1;
+    class_profs[ClassSubjectIndex(c, s)] = -1;
   }
 
-  ComputeProfDayOff(p);
+  UpdateCandidateProfs(c, s, old_candidates);
+
+  // Update prof daily assigned hours: the day off changes only if the day becomes free
+  if (--prof_daily_hours[ProfDayIndex(p, d)] == 0)
+  {
+    prof_free_days[p]++;
+    UpdateProfDayOff(p, d);
+  }
 }
 
 void Sched_Output::SwapHours(unsigned c1, unsigned d1, unsigned h1, unsigned c2, unsigned d2, unsigned h2)
@@ -797,57 +1316,187 @@ void Sched_Output::SwapHours(unsigned c1, unsigned d1, unsigned h1, unsigned c2,
   }
 }
 
-void Sched_Output::ComputeProfDayOff(unsigned p)
+// Swaps hours (d1, h1) and (d2, h2) in all the given classes
+// NOTE: all the cells are freed before assigning them again, so professors can exchange their hours between the
+//       classes (e.g., a Kempe chain, where each single class swap would clash with another class)
+void Sched_Output::SwapHoursInClasses(const vector<unsigned>& classes, unsigned d1, unsigned h1, unsigned d2, unsigned h2)
+{
+  thread_local vector<int> profs_1, profs_2;   // scratch buffers, reused across the calls of the thread
+  unsigned i;
+
+  profs_1.resize(classes.size());
+  profs_2.resize(classes.size());
+  for (i = 0; i < classes.size(); i++)
+  {
+    profs_1[i] = Class_Schedule(classes[i], d1, h1);
+    profs_2[i] = Class_Schedule(classes[i], d2, h2);
+
+    if (profs_1[i] != -1)
+      FreeHour(classes[i], d1, h1);
+    if (profs_2[i] != -1)
+      FreeHour(classes[i], d2, h2);
+  }
+
+  for (i = 0; i < classes.size(); i++)
+  {
+    if (profs_2[i] != -1)
+      AssignHour(classes[i], d1, h1, profs_2[i]);
+    if (profs_1[i] != -1)
+      AssignHour(classes[i], d2, h2, profs_1[i]);
+  }
+}
+
+void Sched_Output::KempeChain(unsigned c, unsigned d1, unsigned h1, unsigned d2, unsigned h2, vector<unsigned>& classes) const
+{
+  thread_local vector<bool> in_chain;   // class-indexed marks of the chain, all false between the calls
+  unsigned i;
+  int p, other_class;
+
+  in_chain.resize(in.N_Classes(), false);
+  classes.assign(1, c);
+  in_chain[c] = true;
+
+  // The professor of an hour goes to the other one, where he may teach another class: that class joins the chain
+  for (i = 0; i < classes.size(); i++)
+  {
+    if ((p = Class_Schedule(classes[i], d1, h1)) != -1 && (other_class = Prof_Schedule(p, d2, h2)) != -1 && !in_chain[other_class])
+    {
+      in_chain[other_class] = true;
+      classes.push_back(other_class);
+    }
+
+    if ((p = Class_Schedule(classes[i], d2, h2)) != -1 && (other_class = Prof_Schedule(p, d1, h1)) != -1 && !in_chain[other_class])
+    {
+      in_chain[other_class] = true;
+      classes.push_back(other_class);
+    }
+  }
+
+  for (i = 0; i < classes.size(); i++)
+    in_chain[classes[i]] = false;
+}
+
+// Swaps the professors of subject s between classes c1 and c2, relabeling their hours in place
+// NOTE: the swap must be feasible, i.e. no professor gets an hour in which he is busy with a third class
+void Sched_Output::SwapSubjectProfs(unsigned c1, unsigned c2, unsigned s)
 {
+  int p1 = Subject_Prof(c1, s);
+  int p2 = Subject_Prof(c2, s);
+  uint64_t hours_1 = ClassSubjectMask(c1, s);
+  uint64_t hours_2 = ClassSubjectMask(c2, s);
+  uint64_t m;
   unsigned d, h;
-  bool school_day = false;
 
-  // If the professor has multiple free days and one of these
-  // is his unavailability day, we consider that as professor day off.
-  for (h = 0; h < in.N_HoursXDay(); h++)
+  if (p1 == -1 || p2 == -1 || p1 == p2)
+    return;
+
+  version = NewVersion();
+
+  // Hours of class 1 go from p1 to p2 and those of class 2 from p2 to p1: first clear the old prof cells...
+  for (m = hours_1; m != 0; m &= m - 1)
+  {
+    d = countr_zero(m) / in.N_HoursXDay();
+    h = countr_zero(m) % in.N_HoursXDay();
+    schedule_class[ClassHourIndex(c1, d, h)] = p2;
+    schedule_prof[ProfHourIndex(p1, d, h)] = -1;
+  }
+  for (m = hours_2; m != 0; m &= m - 1)
+  {
+    d = countr_zero(m) / in.N_HoursXDay();
+    h = countr_zero(m) % in.N_HoursXDay();
+    schedule_class[ClassHourIndex(c2, d, h)] = p1;
+    schedule_prof[ProfHourIndex(p2, d, h)] = -1;
+  }
+
+  // ...then fill the new ones (an hour may be in both classes, so the two steps cannot be merged)
+  for (m = hours_1; m != 0; m &= m - 1)
+    schedule_prof[ProfHourIndex(p2, countr_zero(m) / in.N_HoursXDay(), countr_zero(m) % in.N_HoursXDay())] = c1;
+  for (m = hours_2; m != 0; m &= m - 1)
+    schedule_prof[ProfHourIndex(p1, countr_zero(m) / in.N_HoursXDay(), countr_zero(m) % in.N_HoursXDay())] = c2;
+
+  class_profs[ClassSubjectIndex(c1, s)] = p2;
+  class_profs[ClassSubjectIndex(c2, s)] = p1;
+
+  // Class masks, subject hours, candidate profs and violation totals do not depend on which prof teaches
+  UpdateSwappedProf(p1, hours_1, hours_2);
+  UpdateSwappedProf(p2, hours_2, hours_1);
+}
+
+// Updates mask, counters and day off of prof p, that lost the hours in 'lost' and gained those in 'gained'.
+// The day off is recomputed once, only if some day switched between free and busy
+void Sched_Output::UpdateSwappedProf(unsigned p, uint64_t lost, uint64_t gained)
+{
+  unsigned d, old_hours, new_hours;
+  bool free_days_changed = false;
+
+  prof_mask[p] = (prof_mask[p] & ~lost) | gained;
+  prof_weekly_hours[p] = prof_weekly_hours[p] + popcount(gained) - popcount(lost);
+
+  for (d = 0; d < in.N_Days(); d++)
   {
-    if (Prof_Schedule(p, in.ProfUnavailability(p), h) != -1)
+    old_hours = prof_daily_hours[ProfDayIndex(p, d)];
+    new_hours = old_hours + popcount((gained >> (d * in.N_HoursXDay())) & DayMask()) - popcount((lost >> (d * in.N_HoursXDay())) & DayMask());
+    prof_daily_hours[ProfDayIndex(p, d)] = new_hours;
+
+    if (old_hours == 0 && new_hours > 0)
     {
-      school_day = true;
-      break;
+      prof_free_days[p]--;
+      free_days_changed = true;
+    }
+    else if (old_hours > 0 && new_hours == 0)
+    {
+      prof_free_days[p]++;
+      free_days_changed = true;
     }
   }
-  
-  if (!school_day)
+
+  if (free_days_changed)
+    ComputeProfDayOff(p);
+}
+
+void Sched_Output::ComputeProfDayOff(unsigned p)
+{
+  unsigned d;
+
+  // If the professor has multiple free days and one of these
+  // is his unavailability day, we consider that as professor day off.
+  if (ProfDailyHours(p, in.ProfUnavailability(p)) == 0)
   {
     prof_day_off[p] = (int)in.ProfUnavailability(p);
     return;
   }
 
   // ...If not, We consider another day as professor day off
-  for (d = lun; d < in.N_Days(); d++)
-  {
-    if (d != in.ProfUnavailability(p))
+  if (prof_free_days[p] > 0)
+    for (d = lun; d < in.N_Days(); d++)
     {
-      school_day = false;
-
-      for (h = 0; h < in.N_HoursXDay(); h++)
-      {
-        if (Prof_Schedule(p, d, h) != -1)
-        {
-          school_day = true;
-          break;
-        }
-      }
-
-      if (!school_day)
+      if (d != in.ProfUnavailability(p) && ProfDailyHours(p, d) == 0)
       {
         prof_day_off[p] = (int)d;
         return;
       }
     }
-  }
 
   // Day off doesn't exist
   prof_day_off[p] = -1;
   return;
 }
 
+// Called when day d of prof p switches between free and busy: updates the day off
+// without rescanning the week, unless the current day off is lost
+void Sched_Output::UpdateProfDayOff(unsigned p, unsigned d)
+{
+  if (ProfDailyHours(p, d) == 0) // d is now free
+  {
+    if (d == in.ProfUnavailability(p))
+      prof_day_off[p] = (int)d;
+    else if (prof_day_off[p] == -1 || (prof_day_off[p] != (int)in.ProfUnavailability(p) && (int)d < prof_day_off[p]))
+      prof_day_off[p] = (int)d;
+  }
+  else if ((int)d == prof_day_off[p]) // the day off is now busy
+    ComputeProfDayOff(p);
+}
+
 ostream& operator<<(ostream& os, const Sched_Output& out)
 {
   unsigned c, d, h;
@@ -904,3 +1553,148 @@ istream& operator>>(istream& is, Sched_Output& out)
 
   return is;
 }
+
+template <class Output, class Function>
+void Sched_Output::ForEachTable(Output& out, Function f)
+{
+  f(out.schedule_class);
+  f(out.class_profs);
+  f(out.daily_subject_assigned_hours);
+  f(out.weekly_subject_assigned_hours);
+  f(out.class_mask);
+  f(out.class_subject_mask);
+  f(out.class_open_subjects);
+  f(out.class_candidate_profs);
+  f(out.open_classes);
+  f(out.open_class_position);
+
+  f(out.schedule_prof);
+  f(out.prof_weekly_hours);
+  f(out.prof_daily_hours);
+  f(out.prof_free_days);
+  f(out.prof_day_off);
+  f(out.prof_mask);
+}
+
+void Sched_Output::WriteSnapshot(ostream& os) const
+{
+  SnapshotHeader header = InstanceSnapshotHeader(in);
+  uint32_t totals[4] = {n_open_classes, contiguity_violations, max_subject_hours_x_day_violations, free_class_hours};
+  string payload;
+
+  ForEachTable(*this, [&payload](const auto& table) { payload.append(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(table[0])); });
+  payload.append(reinterpret_cast<const char*>(totals), sizeof(totals));
+
+  header.payload_size = payload.size();
+  header.payload_checksum = Hash(payload.data(), payload.size());
+
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  os.write(payload.data(), payload.size());
+  if (!os)
+    throw runtime_error("Cannot write the Sched_Output snapshot.");
+}
+
+void Sched_Output::LoadSnapshot(const char* buffer, size_t size)
+{
+  SnapshotHeader header, expected = InstanceSnapshotHeader(in);
+  uint32_t totals[4];
+  const char* payload;
+  size_t payload_size = sizeof(totals);
+
+  if (size < sizeof(header))
+    throw runtime_error("Truncated Sched_Output snapshot.");
+  memcpy(&header, buffer, sizeof(header));
+
+  if (memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    throw runtime_error("Not a Sched_Output snapshot.");
+  if (header.format_version != snapshot_format_version)
+    throw runtime_error("Unsupported Sched_Output snapshot version " + to_string(header.format_version) + ".");
+  if (header.byte_order != expected.byte_order)
+    throw runtime_error("Sched_Output snapshot written with a different byte order.");
+  if (header.n_classes != expected.n_classes || header.n_days != expected.n_days || header.n_hours_x_day != expected.n_hours_x_day
+      || header.n_subjects != expected.n_subjects || header.n_profs != expected.n_profs || header.instance_fingerprint != expected.instance_fingerprint)
+    throw runtime_error("Sched_Output snapshot of a different instance.");
+
+  ForEachTable(*this, [&payload_size](const auto& table) { payload_size += table.size() * sizeof(table[0]); });
+  if (header.payload_size != payload_size || size != sizeof(header) + payload_size)
+    throw runtime_error("Truncated Sched_Output snapshot.");
+  payload = buffer + sizeof(header);
+  if (Hash(payload, payload_size) != header.payload_checksum)
+    throw runtime_error("Corrupted Sched_Output snapshot (checksum mismatch).");
+
+  ForEachTable(*this, [&payload](auto& table)
+  {
+    memcpy(table.data(), payload, table.size() * sizeof(table[0]));
+    payload += table.size() * sizeof(table[0]);
+  });
+  memcpy(totals, payload, sizeof(totals));
+  n_open_classes = totals[0];
+  contiguity_violations = totals[1];
+  max_subject_hours_x_day_violations = totals[2];
+  free_class_hours = totals[3];
+
+  if (!ValidSnapshotTables())
+  {
+    Reset();
+    throw runtime_error("Inconsistent Sched_Output snapshot.");
+  }
+  version = NewVersion();
+}
+
+void Sched_Output::ReadSnapshot(const string& filename)
+{
+  MappedFile file;
+
+  if (!file.Open(filename))
+    throw runtime_error("Cannot open snapshot " + filename + ".");
+  LoadSnapshot(file.Data(), file.Size());
+}
+
+bool Sched_Output::IsSnapshot(const string& filename)
+{
+  char magic[sizeof(snapshot_magic)];
+  ifstream is(filename, ios::binary);
+
+  return is.read(magic, sizeof(magic)) && memcmp(magic, snapshot_magic, sizeof(magic)) == 0;
+}
+
+// A snapshot that passed the checksum may still have been written by a faulty build: the derived tables and totals
+// must be the ones rebuilt from schedule_class (a pass over its hours), and the open classes the same set. The cells
+// used as indices by the rebuild and by the open class list are range checked first
+bool Sched_Output::ValidSnapshotTables() const
+{
+  Sched_Output rebuilt(in);
+  unsigned c, d, h, i;
+
+  for (i = 0; i < schedule_class.size(); i++)
+    if (schedule_class[i] < -1 || schedule_class[i] >= (int)in.N_Profs())
+      return false;
+
+  if (n_open_classes > in.N_Classes())
+    return false;
+  for (i = 0; i < in.N_Classes(); i++)
+  {
+    if (open_classes[i] < 0 || open_classes[i] >= (int)in.N_Classes())
+      return false;
+    if (open_class_position[i] < -1 || open_class_position[i] >= (int)in.N_Classes())
+      return false;
+  }
+  for (i = 0; i < n_open_classes; i++)
+    if (open_class_position[open_classes[i]] != (int)i)
+      return false;
+
+  for (c = 0; c < in.N_Classes(); c++)
+    for (d = 0; d < in.N_Days(); d++)
+      for (h = 0; h < in.N_HoursXDay(); h++)
+        if (schedule_class[ClassHourIndex(c, d, h)] != -1)
+          rebuilt.AssignHour(c, d, h, schedule_class[ClassHourIndex(c, d, h)]);
+
+  // operator== leaves out the open class list, whose order depends on the history of the state
+  if (!(rebuilt == *this) || rebuilt.n_open_classes != n_open_classes)
+    return false;
+  for (c = 0; c < in.N_Classes(); c++)
+    if ((rebuilt.open_class_position[c] == -1) != (open_class_position[c] == -1))
+      return false;
+
+  return true;
+}
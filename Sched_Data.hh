@@ -8,6 +8,9 @@
 #include <algorithm>
 #include <string>
 #include <utility>
+#include <cstdint>
+#include <stdexcept>
+#include <bit>
 
 using namespace std;
 
@@ -28,8 +31,9 @@ class Sched_Input
   friend ostream& operator<<(ostream& os, const Sched_Input& in);
   
 public:
-  // Constructor
-  Sched_Input(string file_name);
+  // Constructor: with use_cache, the instance is read from file_name.schedbin (compiled at the first run and
+  // rebuilt whenever the text file changes)
+  Sched_Input(string file_name, bool use_cache = false);
 
   // Schedule data selectors
   unsigned N_Days() const { return n_days; }
@@ -63,6 +67,9 @@ public:
   // Print methods
   void Print(ostream& os) const;
 
+  // Hash of all the instance data, used to check that a saved state belongs to this instance
+  uint64_t Fingerprint() const;
+
   // Cost selectors
   unsigned UnavailabilityViolationCost() const { return unavailability_violation_cost; }
   unsigned MaxSubjectHoursXDayViolationCost() const { return max_subject_hours_x_day_violation_cost; }
@@ -71,6 +78,10 @@ public:
 
   private:
 
+  void Parse(const char* buffer, size_t size);
+  bool ReadCache(const string& cache_filename, uint64_t source_size, int64_t source_time);
+  void WriteCache(const string& cache_filename, uint64_t source_size, int64_t source_time) const;
+
   // Schedule parameters
   unsigned n_days;
   unsigned n_hours_x_day;
@@ -121,16 +132,58 @@ public:
   void Reset();
 
   // Classes selectors
-  int Class_Schedule(unsigned c, unsigned d, unsigned h) const { return schedule_class[c][d][h]; }  // Get the class' schedule - NOTE: Return the prof assigned to an hour
-  int Subject_Prof(unsigned c, unsigned s) const { return class_profs[c][s]; } // Get the subject's prof of a specific class
-  unsigned DailySubjectAssignedHours(unsigned c, unsigned d, unsigned s) const { return daily_subject_assigned_hours[c][d][s]; }
-  unsigned WeeklySubjectAssignedHours(unsigned c, unsigned s) const { return weekly_subject_assigned_hours[c][s]; }
-  unsigned WeeklySubjectResidualHours(unsigned c, unsigned s) const { return in.N_HoursXSubject(s) - weekly_subject_assigned_hours[c][s]; }
+  int Class_Schedule(unsigned c, unsigned d, unsigned h) const { return schedule_class[ClassHourIndex(c, d, h)]; }  // Get the class' schedule - NOTE: Return the prof assigned to an hour
+  int Subject_Prof(unsigned c, unsigned s) const { return class_profs[ClassSubjectIndex(c, s)]; } // Get the subject's prof of a specific class
+  unsigned DailySubjectAssignedHours(unsigned c, unsigned d, unsigned s) const { return daily_subject_assigned_hours[ClassDaySubjectIndex(c, d, s)]; }
+  unsigned WeeklySubjectAssignedHours(unsigned c, unsigned s) const { return weekly_subject_assigned_hours[ClassSubjectIndex(c, s)]; }
+  unsigned WeeklySubjectResidualHours(unsigned c, unsigned s) const { return in.N_HoursXSubject(s) - weekly_subject_assigned_hours[ClassSubjectIndex(c, s)]; }
+
+  // Candidate professors selectors (professors that can get a new hour in a class: the class' prof of a subject
+  // with residual hours, or all the profs of that subject if it has no assigned hours yet)
+  uint64_t ClassOpenSubjects(unsigned c) const { return class_open_subjects[c]; } // Subjects with residual hours (bit s)
+  unsigned ClassCandidateProfs(unsigned c) const { return class_candidate_profs[c]; }
+  unsigned N_OpenClasses() const { return n_open_classes; }  // Classes with at least one candidate prof
+  unsigned OpenClass(unsigned i) const { return open_classes[i]; }
 
   // Profs selectors
-  int Prof_Schedule(unsigned p, unsigned d, unsigned h) const { return schedule_prof[p][d][h]; }  // Get the prof's schedule
+  int Prof_Schedule(unsigned p, unsigned d, unsigned h) const { return schedule_prof[ProfHourIndex(p, d, h)]; }  // Get the prof's schedule
   unsigned ProfWeeklyAssignedHours(unsigned p) const { return prof_weekly_hours[p]; }
   int ProfAssignedDayOff(unsigned p) const { return prof_day_off[p]; } // Get prof day off
+  unsigned ProfDailyHours(unsigned p, unsigned d) const { return prof_daily_hours[ProfDayIndex(p, d)]; } // Hours taught by the prof on a day (any class)
+  unsigned ProfFreeDays(unsigned p) const { return prof_free_days[p]; }  // Days without lessons for the prof
+
+  // Weekly occupancy bitmasks selectors - NOTE: bit (d * N_HoursXDay() + h) is set if the hour is busy
+  unsigned Slot(unsigned d, unsigned h) const { return d * in.N_HoursXDay() + h; }
+  uint64_t DayMask() const { return ~(uint64_t)0 >> (64 - in.N_HoursXDay()); } // Mask of the hours of a single day (shifted to day 0)
+  uint64_t WeekMask() const { return ~(uint64_t)0 >> (64 - in.N_Days() * in.N_HoursXDay()); } // Mask of all the hours of the week
+  uint64_t ClassMask(unsigned c) const { return class_mask[c]; }
+  uint64_t ClassSubjectMask(unsigned c, unsigned s) const { return class_subject_mask[ClassSubjectIndex(c, s)]; } // Hours of subject s in class c (all taught by Subject_Prof(c, s))
+  uint64_t ClassSubjectDayMask(unsigned c, unsigned d, unsigned s) const { return (ClassSubjectMask(c, s) >> (d * in.N_HoursXDay())) & DayMask(); }
+  uint64_t ProfMask(unsigned p) const { return prof_mask[p]; }
+  uint64_t ProfDayMask(unsigned p, unsigned d) const { return (prof_mask[p] >> (d * in.N_HoursXDay())) & DayMask(); }
+
+  // Violation totals, kept up to date by AssignHour and FreeHour
+  static unsigned ContiguityGaps(uint64_t hours) { return hours == 0 ? 0 : popcount(hours & ~(hours << 1)) - 1; } // Gaps between the runs of an hour mask of a day
+  static unsigned NthHour(uint64_t hours, unsigned k) { for (; k > 0; k--) hours &= hours - 1; return countr_zero(hours); } // Position of the k-th (from 0) hour of a mask
+  unsigned ClassSubjectDayGaps(unsigned c, unsigned d, unsigned s) const { return ContiguityGaps(ClassSubjectDayMask(c, d, s)); }
+  unsigned ContiguityViolations() const { return contiguity_violations; }  // Sum of the gaps of all (class, day, subject)
+  unsigned MaxSubjectHoursXDayViolations() const { return max_subject_hours_x_day_violations; }  // Sum of the daily hours over the subject max
+  unsigned FreeClassHours() const { return free_class_hours; }  // Free hours of all the classes
+
+  // Version of the content: a new value is taken at every modification, so two states with the same version
+  // (e.g., a state and its copy) have the same content. Used to reuse computations on an unchanged state
+  uint64_t Version() const { return version; }
+
+  // Kempe chain of hours (d1, h1) and (d2, h2) from class c: the classes whose two hours must be swapped together,
+  // so that every professor moves all his lessons of the two hours (c comes first)
+  void KempeChain(unsigned c, unsigned d1, unsigned h1, unsigned d2, unsigned h2, vector<unsigned>& classes) const;
+
+  // Binary snapshot of the whole state (tables and violation totals): the header is checked against the instance,
+  // then the tables are copied and compared with the ones rebuilt from the class schedule, and rejected on mismatch
+  void WriteSnapshot(ostream& os) const;
+  void ReadSnapshot(const string& filename);   // memory maps the file
+  void LoadSnapshot(const char* buffer, size_t size);
+  static bool IsSnapshot(const string& filename);
 
   // Print methods
   void Print(ostream& os) const;  // Print output class in a user-readable manner
@@ -140,27 +193,65 @@ public:
   void AssignHour(unsigned c, unsigned d, unsigned h, unsigned p);
   void FreeHour(unsigned c, unsigned d, unsigned h);
   void SwapHours(unsigned c1, unsigned d1, unsigned h1, unsigned c2, unsigned d2, unsigned h2);
+  void SwapHoursInClasses(const vector<unsigned>& classes, unsigned d1, unsigned h1, unsigned d2, unsigned h2);
+  void SwapSubjectProfs(unsigned c1, unsigned c2, unsigned s);
 
   //boolean check functions
-  bool IsClassHourFree(unsigned c, unsigned d, unsigned h) const {return Class_Schedule(c, d, h) == -1; }
-  bool IsProfHourFree(unsigned p, unsigned d, unsigned h) const {return Prof_Schedule(p, d, h) == -1; }
+  bool IsClassHourFree(unsigned c, unsigned d, unsigned h) const {return !((class_mask[c] >> Slot(d, h)) & 1); }
+  bool IsProfHourFree(unsigned p, unsigned d, unsigned h) const {return !((prof_mask[p] >> Slot(d, h)) & 1); }
   
 private:
 
   void ComputeProfDayOff(unsigned p);
+  void UpdateProfDayOff(unsigned p, unsigned d);
+  void ResetCandidateProfs();
+  unsigned SubjectCandidateProfs(unsigned c, unsigned s) const;
+  void UpdateCandidateProfs(unsigned c, unsigned s, unsigned old_candidates);
+  void ResetViolationTotals();
+  void UpdateSwappedProf(unsigned p, uint64_t lost, uint64_t gained);
+  template <class Output, class Function>
+  static void ForEachTable(Output& out, Function f);  // the tables, in snapshot order
+  bool ValidSnapshotTables() const;
+
+  // Flat tables index helpers (row-major, the last index is the contiguous one)
+  size_t ClassHourIndex(unsigned c, unsigned d, unsigned h) const { return ((size_t)c * in.N_Days() + d) * in.N_HoursXDay() + h; }
+  size_t ProfHourIndex(unsigned p, unsigned d, unsigned h) const { return ((size_t)p * in.N_Days() + d) * in.N_HoursXDay() + h; }
+  size_t ClassDaySubjectIndex(unsigned c, unsigned d, unsigned s) const { return ((size_t)c * in.N_Days() + d) * in.N_Subjects() + s; }
+  size_t ClassSubjectIndex(unsigned c, unsigned s) const { return (size_t)c * in.N_Subjects() + s; }
+  size_t ProfDayIndex(unsigned p, unsigned d) const { return (size_t)p * in.N_Days() + d; }
 
   const Sched_Input& in;
 
+  // NOTE: every table is a single flat buffer of small cells, so that copying a state
+  //       (done by the runners each time they save the current or best state) is a memcpy per table
+
   // Classes data structures
-  vector<vector<vector<int>>> schedule_class;    // output: class schedule for each class
-  vector<vector<int>> class_profs; // professors teaching to a class
-  vector<vector<vector<unsigned>>> daily_subject_assigned_hours;  //hours of each subject scheduled for each day for each class
-  vector<vector<unsigned>> weekly_subject_assigned_hours;   // quantity of hours of each subject already scheduled for each class
+  vector<int16_t> schedule_class;    // output: class schedule for each class [c][d][h] (-1 = free hour)
+  vector<int16_t> class_profs; // professors teaching to a class [c][s]
+  vector<uint8_t> daily_subject_assigned_hours;  //hours of each subject scheduled for each day for each class [c][d][s]
+  vector<uint8_t> weekly_subject_assigned_hours;   // quantity of hours of each subject already scheduled for each class [c][s]
+  vector<uint64_t> class_mask;    // busy hours of each class
+  vector<uint64_t> class_subject_mask;    // hours of each subject for each class [c][s]
+  vector<uint64_t> class_open_subjects;   // subjects with residual hours for each class
+  vector<uint16_t> class_candidate_profs;   // number of candidate profs for each class
+  vector<int16_t> open_classes;   // classes with candidate profs (first n_open_classes cells, in any order)
+  vector<int16_t> open_class_position;   // position of each class in open_classes (-1 = not open)
+  unsigned n_open_classes;
 
   // Professors data structures
-  vector<vector<vector<int>>> schedule_prof;    // output: professor schedule for each professor
-  vector<unsigned> prof_weekly_hours;   // hours weekly assigned to each professor
-  vector<int> prof_day_off;   // day off of each professor
+  vector<int16_t> schedule_prof;    // output: professor schedule for each professor [p][d][h] (-1 = free hour)
+  vector<uint8_t> prof_weekly_hours;   // hours weekly assigned to each professor
+  vector<uint8_t> prof_daily_hours;   // hours assigned to each professor for each day [p][d]
+  vector<uint8_t> prof_free_days;   // days without lessons of each professor
+  vector<int8_t> prof_day_off;   // day off of each professor
+  vector<uint64_t> prof_mask;    // busy hours of each professor
+
+  // Violation totals
+  unsigned contiguity_violations;
+  unsigned max_subject_hours_x_day_violations;
+  unsigned free_class_hours;
+
+  uint64_t version;
 
 };
 #endif
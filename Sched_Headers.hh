@@ -3,10 +3,50 @@
 #define SCHED_HELPERS_HH
 
 #include "Sched_Data.hh"
+#include "Sched_ThreadPool.hh"
+#include "Sched_Profiler.hh"
+#include "Sched_TrajectoryLogger.hh"
+#include "Sched_Checkpointer.hh"
+#include <chrono>
+#include <sstream>
 #include <easylocal.hh>
 
 using namespace EasyLocal::Core;
 
+/***************************************************************************
+ * Random numbers of the explorers
+ ***************************************************************************/
+
+// The explorers draw from the generator of the chain bound to the calling thread, or from EasyLocal Random if none
+// is bound. Concurrent chains (parallel tempering, island model) bind each their own generator, so that they do not
+// share EasyLocal Random and the moves of a chain depend only on its seed
+class Sched_Random
+{
+public:
+  template <typename T>
+  static T Uniform(T a, T b)
+  {
+    if constexpr (is_floating_point_v<T>)
+      return uniform_real_distribution<T>(a, b)(Generator());
+    else
+      return uniform_int_distribution<T>(a, b)(Generator());
+  }
+  static mt19937& Generator() { return chain_generator != nullptr ? *chain_generator : Random::GetGenerator(); }
+  static bool ChainBound() { return chain_generator != nullptr; }
+
+  // Binds the generator of a chain to the calling thread for the lifetime of the object
+  class ChainScope
+  {
+  public:
+    ChainScope(mt19937& generator) : previous(chain_generator) { chain_generator = &generator; }
+    ~ChainScope() { chain_generator = previous; }
+  private:
+    mt19937* previous;
+  };
+private:
+  inline static thread_local mt19937* chain_generator = nullptr;
+};
+
 /***************************************************************************
  * Solution Manager 
  ***************************************************************************/
@@ -17,6 +57,7 @@ public:
   Sched_SolutionManager(const Sched_Input&);
   void RandomState(Sched_Output& out) override;   
   void GreedyState(Sched_Output& out) override;   
+  void RepairState(Sched_Output& out);   // Assigns the residual hours of a partial solution
   void DumpState(const Sched_Output& out, ostream& os) const override { out.Print(cout); }
   void PrettyPrintOutput(const Sched_Output& out, string filename) const { out.PrintTAB(filename); }
   bool CheckConsistency(const Sched_Output& out) const override;
@@ -71,6 +112,47 @@ public:
   void PrintViolations(const Sched_Output& out, ostream& os = cout) const override;
 };
 
+/***************************************************************************
+ * Fused Delta Cost
+ ***************************************************************************/
+
+class Sched_SwapHours;
+class Sched_AssignProf;
+class Sched_SwapProf;
+class Sched_CrossSwapHours;
+class Sched_KempeChain;
+
+// Unweighted change of each cost component caused by a move
+struct Sched_MoveDeltas
+{
+  int unavailability;
+  int max_subject_hours;
+  int max_weekly_hours;
+  int contiguity;
+  int complete;
+};
+
+// Delta cost of the moves of all the explorers, in place of one delta cost component per (move, cost component):
+// the changes of all the components are computed in one pass over the move, then weighted and mapped onto the cost
+// structure of the solution manager, whose components must be added in the order of the constructor
+class Sched_DeltaCost
+{
+public:
+  Sched_DeltaCost(const Sched_Input& in, const Sched_ProfUnavailability_CC& cc_PU, const Sched_MaxSubjectHoursXDay_CC& cc_MSHD,
+                  const Sched_ProfMaxWeeklyHours_CC& cc_PMWH, const Sched_ScheduleContiguity_CC& cc_SC, const Sched_SolutionComplete_CC& cc_CS);
+  DefaultCostStructure<int> DeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const;
+  DefaultCostStructure<int> DeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const;
+  DefaultCostStructure<int> DeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const;
+  DefaultCostStructure<int> DeltaCost(const Sched_Output& out, const Sched_CrossSwapHours& mv) const;
+  DefaultCostStructure<int> DeltaCost(const Sched_Output& out, const Sched_KempeChain& mv) const;
+
+  // The weighted cost structure of the deltas of a move
+  DefaultCostStructure<int> CostStructure(const Sched_MoveDeltas& deltas) const;
+protected:
+  const Sched_Input& in;
+  const CostComponent<Sched_Input,Sched_Output>* components[5];   // in the order of the fields of Sched_MoveDeltas
+};
+
 /***************************************************************************
  * Sched_SwapHours Neighborhood Explorer - Moves:
  ***************************************************************************/
@@ -101,72 +183,29 @@ class Sched_SwapHours_NeighborhoodExplorer
   : public NeighborhoodExplorer<Sched_Input,Sched_Output,Sched_SwapHours> 
 {
 public:
-  Sched_SwapHours_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input,Sched_Output>& psm)  
-    : NeighborhoodExplorer<Sched_Input,Sched_Output,Sched_SwapHours>(pin, psm, "Sched_SwapHours_NeighborhoodExplorer") {} 
+  Sched_SwapHours_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input,Sched_Output>& psm, const Sched_DeltaCost& pdc)  
+    : NeighborhoodExplorer<Sched_Input,Sched_Output,Sched_SwapHours>(pin, psm, "Sched_SwapHours_NeighborhoodExplorer"), delta_cost(pdc), violation_bias(0.0) {} 
   void RandomMove(const Sched_Output&, Sched_SwapHours&) const override;          
   bool FeasibleMove(const Sched_Output&, const Sched_SwapHours&) const override;  
   void MakeMove(Sched_Output&, const Sched_SwapHours&) const override;             
   void FirstMove(const Sched_Output&, Sched_SwapHours&) const override;  
   bool NextMove(const Sched_Output&, Sched_SwapHours&) const override;   
-protected:
-  bool AnyNextMove(const Sched_Output&, Sched_SwapHours&) const;
-};
-
-/***************************************************************************
- * Sched_SwapHours Neighborhood Explorer - DeltaCosts:
- ***************************************************************************/
+  DefaultCostStructure<int> DeltaCostFunctionComponents(const Sched_Output& out, const Sched_SwapHours& mv, const vector<double>& weights = vector<double>(0)) const override
+    { return delta_cost.DeltaCost(out, mv); }
 
-class Sched_SwapHoursDeltaProfUnavailability
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>
-{
-public:
-  Sched_SwapHoursDeltaProfUnavailability(const Sched_Input& in, Sched_ProfUnavailability_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>(in,cc,"Sched_SwapHoursDeltaProfUnavailability") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const override;
-};
+  // Block-wise exploration (a block is a class), used by the parallel neighborhood evaluation
+  unsigned N_Blocks() const { return in.N_Classes(); }
+  bool FirstMoveInBlock(const Sched_Output&, Sched_SwapHours&, unsigned b) const;
+  bool NextMoveInBlock(const Sched_Output&, Sched_SwapHours&) const;
 
-class Sched_SwapHoursDeltaMaxSubjectHoursXDay
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>
-{
-public:
-  Sched_SwapHoursDeltaMaxSubjectHoursXDay(const Sched_Input& in, Sched_MaxSubjectHoursXDay_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>(in,cc,"Sched_SwapHoursDeltaMaxSubjectHoursXDay") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const override;
-};
-
-class Sched_SwapHoursDeltaProfMaxWeeklyHours
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>
-{
-public:
-  Sched_SwapHoursDeltaProfMaxWeeklyHours(const Sched_Input& in, Sched_ProfMaxWeeklyHours_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>(in,cc,"Sched_SwapHoursDeltaProfMaxWeeklyHours") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const override { return 0; }   // SwapHours can't change this cost
-};
-
-class Sched_SwapHoursDeltaScheduleContiguity
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>
-{
-public:
-  Sched_SwapHoursDeltaScheduleContiguity(const Sched_Input& in, Sched_ScheduleContiguity_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>(in,cc,"Sched_SwapHoursDeltaScheduleContiguity") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const override;
-};
-
-class Sched_SwapHoursDeltaCompleteSolution
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>
-{
-public:
-  Sched_SwapHoursDeltaCompleteSolution(const Sched_Input& in, Sched_SolutionComplete_CC& cc)
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapHours>(in,cc,"Sched_SwapHoursDeltaCompleteSolution") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapHours& mv) const override { return 0; }   // SwapHours can't change this cost
+  // Probability that RandomMove draws its first hour among the ones involved in a violation
+  void SetViolationBias(double value) { violation_bias = value; }
+protected:
+  bool AnyNextMove(const Sched_Output&, Sched_SwapHours&) const;
+  const Sched_DeltaCost& delta_cost;
+  double violation_bias;
 };
 
-
 /***************************************************************************
  * Sched_AssignProf Neighborhood Explorer - Moves:
  ***************************************************************************/
@@ -197,164 +236,617 @@ class Sched_AssignProf_NeighborhoodExplorer
   : public NeighborhoodExplorer<Sched_Input,Sched_Output,Sched_AssignProf> 
 {
 public:
-  Sched_AssignProf_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input,Sched_Output>& psm)  
-    : NeighborhoodExplorer<Sched_Input,Sched_Output,Sched_AssignProf>(pin, psm, "Sched_AssignProf_NeighborhoodExplorer") {} 
+  Sched_AssignProf_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input,Sched_Output>& psm, const Sched_DeltaCost& pdc)  
+    : NeighborhoodExplorer<Sched_Input,Sched_Output,Sched_AssignProf>(pin, psm, "Sched_AssignProf_NeighborhoodExplorer"), delta_cost(pdc) {} 
   void RandomMove(const Sched_Output&, Sched_AssignProf&) const override;          
   bool FeasibleMove(const Sched_Output&, const Sched_AssignProf&) const override;  
   void MakeMove(Sched_Output&, const Sched_AssignProf&) const override;             
   void FirstMove(const Sched_Output&, Sched_AssignProf&) const override;  
   bool NextMove(const Sched_Output&, Sched_AssignProf&) const override;   
+  DefaultCostStructure<int> DeltaCostFunctionComponents(const Sched_Output& out, const Sched_AssignProf& mv, const vector<double>& weights = vector<double>(0)) const override
+    { return delta_cost.DeltaCost(out, mv); }
+
+  // Block-wise exploration (a block is a class), used by the parallel neighborhood evaluation
+  unsigned N_Blocks() const { return in.N_Classes(); }
+  bool FirstMoveInBlock(const Sched_Output&, Sched_AssignProf&, unsigned b) const;
+  bool NextMoveInBlock(const Sched_Output&, Sched_AssignProf&) const;
 protected:
   bool AnyNextMove(const Sched_Output&, Sched_AssignProf&) const;   
+  const Sched_DeltaCost& delta_cost;
 };
 
 /***************************************************************************
- * Sched_AssignProf Neighborhood Explorer - DeltaCosts:
+ * Sched_SwapProf Neighborhood Explorer - Moves:
  ***************************************************************************/
 
-class Sched_AssignProfDeltaProfUnavailability
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>
+class Sched_SwapProf
 {
+  friend bool operator==(const Sched_SwapProf& mv1, const Sched_SwapProf& mv2);
+  friend bool operator!=(const Sched_SwapProf& mv1, const Sched_SwapProf& mv2);
+  friend bool operator<(const Sched_SwapProf& mv1, const Sched_SwapProf& mv2);
+  friend ostream& operator<<(ostream& os, const Sched_SwapProf& c);
+  friend istream& operator>>(istream& is, Sched_SwapProf& c);
+
 public:
-  Sched_AssignProfDeltaProfUnavailability(const Sched_Input& in, Sched_ProfUnavailability_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>(in,cc,"Sched_AssignProfDeltaProfUnavailability") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const override;
+  int subject;
+  int class_1;
+  int class_2;
+
+  Sched_SwapProf();
 };
 
-class Sched_AssignProfDeltaMaxSubjectHoursXDay
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>
+
+/***************************************************************************
+ * Sched_SwapProf Neighborhood Explorer - Neighborhood Manager:
+ ***************************************************************************/
+
+class Sched_SwapProf_NeighborhoodExplorer
+  : public NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_SwapProf>
 {
 public:
-  Sched_AssignProfDeltaMaxSubjectHoursXDay(const Sched_Input& in, Sched_MaxSubjectHoursXDay_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>(in,cc,"Sched_AssignProfDeltaMaxSubjectHoursXDay") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const override;
+  Sched_SwapProf_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input, Sched_Output>& psm, const Sched_DeltaCost& pdc)
+    : NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_SwapProf>(pin, psm, "Sched_SwapProf_NeighborhoodExplorer"), delta_cost(pdc) {}
+  void RandomMove(const Sched_Output&, Sched_SwapProf&) const override;
+  bool FeasibleMove(const Sched_Output&, const Sched_SwapProf&) const override;
+  void MakeMove(Sched_Output&, const Sched_SwapProf&) const override;
+  void FirstMove(const Sched_Output&, Sched_SwapProf&) const override;
+  bool NextMove(const Sched_Output&, Sched_SwapProf&) const override;
+  DefaultCostStructure<int> DeltaCostFunctionComponents(const Sched_Output& out, const Sched_SwapProf& mv, const vector<double>& weights = vector<double>(0)) const override
+    { return delta_cost.DeltaCost(out, mv); }
+
+  // Block-wise exploration (a block is a subject), used by the parallel neighborhood evaluation
+  unsigned N_Blocks() const { return in.N_Subjects(); }
+  bool FirstMoveInBlock(const Sched_Output&, Sched_SwapProf&, unsigned b) const;
+  bool NextMoveInBlock(const Sched_Output&, Sched_SwapProf&) const;
+protected:
+  bool AnyNextMove(const Sched_Output&, Sched_SwapProf&) const;
+  const Sched_DeltaCost& delta_cost;
 };
 
-class Sched_AssignProfDeltaProfMaxWeeklyHours
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>
+
+/***************************************************************************
+ * Sched_CrossSwapHours Neighborhood Explorer - Moves:
+ ***************************************************************************/
+
+// Swaps hours (day_1, hour_1) and (day_2, hour_2) in both class_1 and class_2, where the professor of
+// class_1 at (day_1, hour_1) is the one of class_2 at (day_2, hour_2): his two lessons exchange their hours
+// NOTE: canonical form class_1 < class_2 (and day_1/hour_1 before day_2/hour_2 when the other professor
+//       of the two hours also teaches in both classes)
+class Sched_CrossSwapHours
 {
+  friend bool operator==(const Sched_CrossSwapHours& mv1, const Sched_CrossSwapHours& mv2);
+  friend bool operator!=(const Sched_CrossSwapHours& mv1, const Sched_CrossSwapHours& mv2);
+  friend bool operator<(const Sched_CrossSwapHours& mv1, const Sched_CrossSwapHours& mv2);
+  friend ostream& operator<<(ostream& os, const Sched_CrossSwapHours& c);
+  friend istream& operator>>(istream& is, Sched_CrossSwapHours& c);
+
 public:
-  Sched_AssignProfDeltaProfMaxWeeklyHours(const Sched_Input& in, Sched_ProfMaxWeeklyHours_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>(in,cc,"Sched_AssignProfDeltaProfMaxWeeklyHours") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const override;
+  int class_1;
+  int class_2;
+  int day_1;
+  int hour_1;
+  int day_2;
+  int hour_2;
+
+  Sched_CrossSwapHours();
 };
 
-class Sched_AssignProfDeltaScheduleContiguity
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>
+
+/***************************************************************************
+ * Sched_CrossSwapHours Neighborhood Explorer - Neighborhood Manager:
+ ***************************************************************************/
+
+class Sched_CrossSwapHours_NeighborhoodExplorer
+  : public NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_CrossSwapHours>
 {
 public:
-  Sched_AssignProfDeltaScheduleContiguity(const Sched_Input& in, Sched_ScheduleContiguity_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>(in,cc,"Sched_AssignProfDeltaScheduleContiguity") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const override;
+  Sched_CrossSwapHours_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input, Sched_Output>& psm, const Sched_DeltaCost& pdc)
+    : NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_CrossSwapHours>(pin, psm, "Sched_CrossSwapHours_NeighborhoodExplorer"), delta_cost(pdc) {}
+  void RandomMove(const Sched_Output&, Sched_CrossSwapHours&) const override;
+  bool FeasibleMove(const Sched_Output&, const Sched_CrossSwapHours&) const override;
+  void MakeMove(Sched_Output&, const Sched_CrossSwapHours&) const override;
+  void FirstMove(const Sched_Output&, Sched_CrossSwapHours&) const override;
+  bool NextMove(const Sched_Output&, Sched_CrossSwapHours&) const override;
+  DefaultCostStructure<int> DeltaCostFunctionComponents(const Sched_Output& out, const Sched_CrossSwapHours& mv, const vector<double>& weights = vector<double>(0)) const override
+    { return delta_cost.DeltaCost(out, mv); }
+
+  // Block-wise exploration (a block is class_1), used by the parallel neighborhood evaluation
+  unsigned N_Blocks() const { return in.N_Classes(); }
+  bool FirstMoveInBlock(const Sched_Output&, Sched_CrossSwapHours&, unsigned b) const;
+  bool NextMoveInBlock(const Sched_Output&, Sched_CrossSwapHours&) const;
+protected:
+  bool AnyNextMove(const Sched_Output&, Sched_CrossSwapHours&) const;
+  const Sched_DeltaCost& delta_cost;
 };
 
-class Sched_AssignProfDeltaCompleteSolution
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>
+
+/***************************************************************************
+ * Sched_KempeChain Neighborhood Explorer - Moves:
+ ***************************************************************************/
+
+// Swaps hours (day_1, hour_1) and (day_2, hour_2) in all the classes of the Kempe chain of _class (see
+// Sched_Output::KempeChain), so every professor moves all his lessons of the two hours and no clash is created
+// NOTE: the chains of one and two classes are SwapHours and CrossSwapHours moves, so the chain has at least three
+//       classes. Canonical form: _class is the lowest class of the chain and day_1/hour_1 come before day_2/hour_2
+class Sched_KempeChain
 {
+  friend bool operator==(const Sched_KempeChain& mv1, const Sched_KempeChain& mv2);
+  friend bool operator!=(const Sched_KempeChain& mv1, const Sched_KempeChain& mv2);
+  friend bool operator<(const Sched_KempeChain& mv1, const Sched_KempeChain& mv2);
+  friend ostream& operator<<(ostream& os, const Sched_KempeChain& c);
+  friend istream& operator>>(istream& is, Sched_KempeChain& c);
+
 public:
-  Sched_AssignProfDeltaCompleteSolution(const Sched_Input& in, Sched_SolutionComplete_CC& cc)
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_AssignProf>(in,cc,"Sched_AssignProfDeltaCompleteSolution") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_AssignProf& mv) const override { return -1; } // AssignProf always resolve 1 violation
+  int _class;
+  int day_1;
+  int hour_1;
+  int day_2;
+  int hour_2;
+
+  Sched_KempeChain();
 };
 
 
 /***************************************************************************
- * Sched_SwapProf Neighborhood Explorer - Moves:
+ * Sched_KempeChain Neighborhood Explorer - Neighborhood Manager:
  ***************************************************************************/
 
-class Sched_SwapProf
+class Sched_KempeChain_NeighborhoodExplorer
+  : public NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_KempeChain>
 {
-  friend bool operator==(const Sched_SwapProf& mv1, const Sched_SwapProf& mv2);
-  friend bool operator!=(const Sched_SwapProf& mv1, const Sched_SwapProf& mv2);
-  friend bool operator<(const Sched_SwapProf& mv1, const Sched_SwapProf& mv2);
-  friend ostream& operator<<(ostream& os, const Sched_SwapProf& c);
-  friend istream& operator>>(istream& is, Sched_SwapProf& c);
+public:
+  Sched_KempeChain_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input, Sched_Output>& psm, const Sched_DeltaCost& pdc)
+    : NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_KempeChain>(pin, psm, "Sched_KempeChain_NeighborhoodExplorer"), delta_cost(pdc) {}
+  void RandomMove(const Sched_Output&, Sched_KempeChain&) const override;
+  bool FeasibleMove(const Sched_Output&, const Sched_KempeChain&) const override;
+  void MakeMove(Sched_Output&, const Sched_KempeChain&) const override;
+  void FirstMove(const Sched_Output&, Sched_KempeChain&) const override;
+  bool NextMove(const Sched_Output&, Sched_KempeChain&) const override;
+  DefaultCostStructure<int> DeltaCostFunctionComponents(const Sched_Output& out, const Sched_KempeChain& mv, const vector<double>& weights = vector<double>(0)) const override
+    { return delta_cost.DeltaCost(out, mv); }
+
+  // Block-wise exploration (a block is a pair of days day_1 <= day_2: the moves of a block read only those days),
+  // used by the parallel neighborhood evaluation
+  unsigned N_Blocks() const { return in.N_Days() * (in.N_Days() + 1) / 2; }
+  unsigned Block(unsigned d1, unsigned d2) const { return d1 * in.N_Days() - d1 * (d1 - 1) / 2 + d2 - d1; }
+  bool FirstMoveInBlock(const Sched_Output&, Sched_KempeChain&, unsigned b) const;
+  bool NextMoveInBlock(const Sched_Output&, Sched_KempeChain&) const;
+protected:
+  bool AnyNextMove(const Sched_Output&, Sched_KempeChain&) const;
+  const Sched_DeltaCost& delta_cost;
+};
+
+
+/***************************************************************************
+ * Observers of the moves of the union
+ ***************************************************************************/
 
+typedef tuple<ActiveMove<Sched_SwapHours>, ActiveMove<Sched_AssignProf>, ActiveMove<Sched_SwapProf>, ActiveMove<Sched_CrossSwapHours>, ActiveMove<Sched_KempeChain>> Sched_UnionMove;
+
+// A feature that follows the moves of the union explorer is an observer registered on it, and each event costs one
+// call per registered observer (none if no feature is on). The move made is the one last evaluated by
+// DeltaCostFunctionComponents or selected by SelectBest, as in the EasyLocal runners
+class Sched_MoveObserver
+{
 public:
-  int subject;
-  int class_1;
-  int class_2;
+  virtual ~Sched_MoveObserver() {}
+  virtual void MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta) {}
+  virtual void BestSelected(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations) {}
+  virtual void MoveMade(const Sched_Output& st, const Sched_UnionMove& mv) {} // st is the state before the move
+};
 
-  Sched_SwapProf();
+// Adaptive selection of the neighborhood of the random moves: RandomMove draws the neighborhood with probability
+// proportional to a weight that follows its improvement per microsecond (of RandomMove and delta evaluation), updated
+// every segment_length random moves. The counters are shared by concurrent chains (e.g. parallel tempering), the
+// move drawn and waiting for its evaluation and for MakeMove is kept by each thread
+class Sched_AdaptiveSelection : public Sched_MoveObserver
+{
+public:
+  Sched_AdaptiveSelection(unsigned long segment_length = 1000, double reaction = 0.2);
+  double Weight(unsigned i) const { return operator_stats[i].weight.load(memory_order_relaxed); }
+  void PrintStatistics(ostream& os, const bool enabled[5]) const;
+
+  // Called by RandomMove: start of the draw, a neighborhood drawn empty, the neighborhood of the move drawn, no move
+  void DrawStarted();
+  void NeighborhoodEmpty(unsigned i);
+  void NeighborhoodDrawn(unsigned i);
+  void DrawFailed();
+
+  void MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta) override;
+  void MoveMade(const Sched_Output& st, const Sched_UnionMove& mv) override;
+protected:
+  void UpdateWeights();
+
+  // The segment counters are reset by the weight update
+  struct OperatorStatistics
+  {
+    atomic<unsigned long> selections, empty, accepted, improving;
+    atomic<long> improvement;
+    atomic<unsigned long> time_ns;
+    atomic<long> segment_improvement;
+    atomic<unsigned long> segment_time_ns;
+    atomic<double> weight;
+  };
+  unsigned long segment_length;
+  double reaction;   // share of the new score in the weight update
+  OperatorStatistics operator_stats[5];
+  atomic<unsigned long> segment_selections;
+  mutex weights_mutex;
 };
 
+// Run statistics of a single chain: moves made, delta evaluations (of random moves and of SelectBest) and time from
+// the construction to the last improvement of the cost, following the deltas of the moves made
+class Sched_RunStatistics : public Sched_MoveObserver
+{
+public:
+  Sched_RunStatistics();
+  unsigned long MadeMoves() const { return made_moves; }
+  unsigned long DeltaEvaluations() const { return delta_evaluations; }
+  double TimeToBest() const { return time_to_best; }
+
+  void MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta) override;
+  void BestSelected(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations) override;
+  void MoveMade(const Sched_Output& st, const Sched_UnionMove& mv) override;
+protected:
+  chrono::steady_clock::time_point run_start;
+  unsigned long made_moves, delta_evaluations;
+  long current_delta, best_delta;   // cost of the trajectory with respect to its start
+  double time_to_best;
+  bool last_valid;   // a move has been evaluated or selected since the last move made
+  int last_delta;
+};
+
+// Trajectory log of a single chain: the cost after the moves made, followed with the deltas of the moves and logged at
+// the start, at each new best cost and every sample_interval moves. The cost of a move made without a delta
+// evaluation (not the usual case for the runners) is taken from the full cost of the state at the next move
+class Sched_TrajectoryRecorder : public Sched_MoveObserver
+{
+public:
+  Sched_TrajectoryRecorder(SolutionManager<Sched_Input, Sched_Output>& sm, Sched_TrajectoryLogger& logger, unsigned long sample_interval = 10000);
+  unsigned long Moves() const { return moves; }
+
+  void MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta) override;
+  void BestSelected(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations) override;
+  void MoveMade(const Sched_Output& st, const Sched_UnionMove& mv) override;
+protected:
+  void Record();
+
+  SolutionManager<Sched_Input, Sched_Output>& sm;
+  Sched_TrajectoryLogger& logger;
+  unsigned long sample_interval;
+  bool started, resync;   // resync: the cost of the last move made is not known yet
+  unsigned long moves;
+  DefaultCostStructure<int> cost, best;
+  bool last_valid;   // a move has been evaluated or selected since the last move made
+  DefaultCostStructure<int> last_delta;
+};
 
 /***************************************************************************
- * Sched_SwapProf Neighborhood Explorer - Neighborhood Manager:
+ * Union Neighborhood Explorer with parallel SelectBest
  ***************************************************************************/
 
-class Sched_SwapProf_NeighborhoodExplorer
-  : public NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_SwapProf>
+// Union of the five neighborhoods whose SelectBest (used by SteepestDescent and TabuSearch) splits
+// each neighborhood in blocks and evaluates them on a thread pool. CrossSwapHours and KempeChain are off
+// by default: the disabled neighborhoods are neither drawn nor explored. The best move of each block is
+// reduced in block order, so the result does not depend on the scheduling of the threads.
+// With a single thread and all the neighborhoods enabled the sequential SelectBest of the union is used.
+// In incremental mode the evaluated moves of each block are cached: MakeMove records the classes,
+// professors and days touched by the move and only the blocks whose moves read them are evaluated again.
+// NOTE: incremental mode is for single-trajectory runners (SD, TS), MakeMove then updates the cache
+class Sched_ParallelUnion_NeighborhoodExplorer
+  : public SetUnionNeighborhoodExplorer<Sched_Input, Sched_Output, DefaultCostStructure<int>, Sched_SwapHours_NeighborhoodExplorer, Sched_AssignProf_NeighborhoodExplorer, Sched_SwapProf_NeighborhoodExplorer, Sched_CrossSwapHours_NeighborhoodExplorer, Sched_KempeChain_NeighborhoodExplorer>
 {
+  typedef SetUnionNeighborhoodExplorer<Sched_Input, Sched_Output, DefaultCostStructure<int>, Sched_SwapHours_NeighborhoodExplorer, Sched_AssignProf_NeighborhoodExplorer, Sched_SwapProf_NeighborhoodExplorer, Sched_CrossSwapHours_NeighborhoodExplorer, Sched_KempeChain_NeighborhoodExplorer> UnionNHE;
 public:
-  Sched_SwapProf_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input, Sched_Output>& psm)
-    : NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_SwapProf>(pin, psm, "Sched_SwapProf_NeighborhoodExplorer") {}
-  void RandomMove(const Sched_Output&, Sched_SwapProf&) const override;
-  bool FeasibleMove(const Sched_Output&, const Sched_SwapProf&) const override;
-  void MakeMove(Sched_Output&, const Sched_SwapProf&) const override;
-  void FirstMove(const Sched_Output&, Sched_SwapProf&) const override;
-  bool NextMove(const Sched_Output&, Sched_SwapProf&) const override;
+  Sched_ParallelUnion_NeighborhoodExplorer(const Sched_Input& pin, SolutionManager<Sched_Input,Sched_Output>& psm, string name,
+                                           Sched_SwapHours_NeighborhoodExplorer& swap_h_nhe, Sched_AssignProf_NeighborhoodExplorer& assign_p_nhe, Sched_SwapProf_NeighborhoodExplorer& swap_p_nhe,
+                                           Sched_CrossSwapHours_NeighborhoodExplorer& cross_h_nhe, Sched_KempeChain_NeighborhoodExplorer& kempe_nhe, Sched_ThreadPool& pool)
+    : UnionNHE(pin, psm, name, swap_h_nhe, assign_p_nhe, swap_p_nhe, cross_h_nhe, kempe_nhe), swap_h_nhe(swap_h_nhe), assign_p_nhe(assign_p_nhe), swap_p_nhe(swap_p_nhe), cross_h_nhe(cross_h_nhe),
+      kempe_nhe(kempe_nhe), pool(pool),
+      enabled{true, true, true, false, false}, incremental(false), cache_valid(false), cache_version(0), adaptive(nullptr) {}
+  EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>> SelectBest(const Sched_Output& st, size_t& explored, const MoveAcceptor& AcceptMove, const vector<double>& weights = vector<double>(0)) const override;
+  void RandomMove(const Sched_Output& st, Sched_UnionMove& mv) const override;
+  DefaultCostStructure<int> DeltaCostFunctionComponents(const Sched_Output& st, const Sched_UnionMove& mv, const vector<double>& weights = vector<double>(0)) const override;
+  void MakeMove(Sched_Output& st, const Sched_UnionMove& mv) const override;
+
+  // Neighborhoods in the order of Sched_UnionMove
+  void SetNeighborhoodEnabled(unsigned i, bool value) { enabled[i] = value; cache_valid = false; }
+  bool NeighborhoodEnabled(unsigned i) const { return enabled[i]; }
+  bool AllNeighborhoodsEnabled() const { return count(enabled, enabled + 5, false) == 0; }
+
+  void SetIncremental(bool value) { incremental = value; cache_valid = false; }
+  bool Incremental() const { return incremental; }
+  size_t EvaluatedMoves() const { return evaluated_moves; }  // Delta evaluations done by the last SelectBest (incremental mode)
+
+  // The observers are not owned, and must be removed before they go
+  void AddObserver(Sched_MoveObserver* observer) { observers.push_back(observer); }
+  void RemoveObserver(Sched_MoveObserver* observer) { observers.erase(remove(observers.begin(), observers.end(), observer), observers.end()); }
+
+  // Adaptive mode: RandomMove draws the neighborhoods by the weights of the adaptive selection, an observer of the
+  // moves as well (nullptr to stop)
+  void SetAdaptiveSelection(Sched_AdaptiveSelection* adaptive);
+  bool AdaptiveSelection() const { return adaptive != nullptr; }
+  void PrintOperatorStatistics(ostream& os = cout) const { adaptive->PrintStatistics(os, enabled); }
 protected:
-  bool AnyNextMove(const Sched_Output&, Sched_SwapProf&) const;
+  template <size_t i, class NHE>
+  void SelectBestInNeighborhood(const NHE& nhe, const Sched_Output& st, EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t& explored, const MoveAcceptor& AcceptMove, const vector<double>& weights) const;
+  template <size_t i, class NHE>
+  bool RandomMoveInNeighborhood(const NHE& nhe, const Sched_Output& st, Sched_UnionMove& mv) const;
+  unsigned DrawNeighborhood(const bool excluded[5]) const;
+  void RecordSelectBest(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations) const;
+  void MakeCachedMove(Sched_Output& st, const Sched_UnionMove& mv) const;
+  template <size_t i, class NHE>
+  void SelectBestInCachedNeighborhood(const NHE& nhe, const Sched_Output& st, EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t& explored, const MoveAcceptor& AcceptMove) const;
+  void MarkStaleBlocks(const Sched_Output& st, const vector<unsigned>& classes, const vector<unsigned>& profs, const vector<unsigned>& days) const;
+
+  Sched_SwapHours_NeighborhoodExplorer& swap_h_nhe;
+  Sched_AssignProf_NeighborhoodExplorer& assign_p_nhe;
+  Sched_SwapProf_NeighborhoodExplorer& swap_p_nhe;
+  Sched_CrossSwapHours_NeighborhoodExplorer& cross_h_nhe;
+  Sched_KempeChain_NeighborhoodExplorer& kempe_nhe;
+  Sched_ThreadPool& pool;
+  bool enabled[5];
+
+  // Incremental mode: cache_version is the version of the state the cached moves refer to
+  bool incremental;
+  mutable bool cache_valid;
+  mutable uint64_t cache_version;
+  mutable vector<vector<EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>>> cached_moves[5]; // [neighborhood][block]
+  mutable vector<bool> stale_blocks[5];   // [neighborhood][block]
+  mutable size_t evaluated_moves;
+
+  vector<Sched_MoveObserver*> observers;
+  Sched_AdaptiveSelection* adaptive;
 };
 
-
 /***************************************************************************
- * Sched_SwapProf Neighborhood Explorer - DeltaCosts:
+ * Runners with checkpoints
  ***************************************************************************/
 
-class Sched_SwapProfDeltaProfUnavailability
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>
+// Checkpoints of a single EasyLocal runner, taken at the end of an iteration when one is due: the current and the
+// best state, the iteration counters (the idle iterations of HC and TS are iteration - iteration_of_best), the
+// evaluations, the running time and EasyLocal Random, plus the state of the runner itself (SaveRunnerState).
+// A resumed run restores all of it right after the initialization of the runner, so it goes on as the run that
+// saved the checkpoint would have
+class Sched_RunnerCheckpoints
 {
 public:
-  Sched_SwapProfDeltaProfUnavailability(const Sched_Input& in, Sched_ProfUnavailability_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>(in,cc,"Sched_SwapProfDeltaProfUnavailability") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const override;
+  Sched_RunnerCheckpoints() : checkpointer(nullptr), resumed(nullptr), resumed_elapsed(0.0) {}
+  virtual ~Sched_RunnerCheckpoints() {}
+  // The resumed checkpoint is used by the next run, and must live until it starts
+  void SetCheckpointer(Sched_Checkpointer* pcheckpointer, const Sched_Checkpointer::Checkpoint* presumed = nullptr) { checkpointer = pcheckpointer; resumed = presumed; }
+  virtual bool ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const { return HasFields(checkpoint, 0, 0) && checkpoint.moves.empty(); }
+protected:
+  bool HasFields(const Sched_Checkpointer::Checkpoint& checkpoint, size_t runner_counters, size_t runner_values) const
+    { return checkpoint.states.size() == 2 && checkpoint.generators.size() == 1 && checkpoint.counters.size() == 3 + runner_counters && checkpoint.values.size() == runner_values; }
+  virtual void SaveRunnerState(Sched_Checkpointer::Checkpoint&) const {}
+  virtual void RestoreRunnerState(const Sched_Checkpointer::Checkpoint&) {}
+
+  Sched_Checkpointer* checkpointer;
+  const Sched_Checkpointer::Checkpoint* resumed;
+  chrono::steady_clock::time_point run_start;
+  double resumed_elapsed;
 };
 
-class Sched_SwapProfDeltaMaxSubjectHoursXDay
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>
+template <class BaseRunner>
+class Sched_CheckpointedRunner : public BaseRunner, public Sched_RunnerCheckpoints
 {
 public:
-  Sched_SwapProfDeltaMaxSubjectHoursXDay(const Sched_Input& in, Sched_MaxSubjectHoursXDay_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>(in,cc,"Sched_SwapProfDeltaMaxSubjectHoursXDay") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const override { return 0; }  // SwapProf can't change this cost
+  using BaseRunner::BaseRunner;
+protected:
+  void InitializeRun() override;
+  void CompleteIteration() override;
+  void SubmitCheckpoint() const;
 };
 
-class Sched_SwapProfDeltaProfMaxWeeklyHours
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>
+template <class BaseRunner>
+void Sched_CheckpointedRunner<BaseRunner>::InitializeRun()
+{
+  BaseRunner::InitializeRun();
+  run_start = chrono::steady_clock::now();
+  resumed_elapsed = 0.0;
+  if (resumed == nullptr)
+    return;
+
+  // Random is restored after the initialization of the runner, that may draw from it (the start temperature of SA)
+  istringstream(resumed->generators[0]) >> Random::GetGenerator();
+  *this->p_best_state = resumed->states[1];
+  this->best_state_cost = this->sm.CostFunctionComponents(*this->p_best_state);
+  this->iteration = resumed->counters[0];
+  this->iteration_of_best = resumed->counters[1];
+  this->evaluations = resumed->counters[2];
+  resumed_elapsed = resumed->elapsed;
+  RestoreRunnerState(*resumed);
+  resumed = nullptr;
+}
+
+template <class BaseRunner>
+void Sched_CheckpointedRunner<BaseRunner>::CompleteIteration()
+{
+  BaseRunner::CompleteIteration();
+  if (checkpointer != nullptr && checkpointer->Due())
+    SubmitCheckpoint();
+}
+
+// The states are copied only here, when the checkpoint is due
+template <class BaseRunner>
+void Sched_CheckpointedRunner<BaseRunner>::SubmitCheckpoint() const
+{
+  Sched_Checkpointer::Checkpoint checkpoint;
+  ostringstream generator;
+
+  generator << Random::GetGenerator();
+  checkpoint.runner = this->name;
+  checkpoint.elapsed = resumed_elapsed + chrono::duration<double>(chrono::steady_clock::now() - run_start).count();
+  checkpoint.counters = {this->iteration, this->iteration_of_best, this->evaluations};
+  checkpoint.generators.push_back(generator.str());
+  checkpoint.states.push_back(*this->p_current_state);
+  checkpoint.states.push_back(*this->p_best_state);
+  SaveRunnerState(checkpoint);
+  checkpointer->Submit(move(checkpoint));
+}
+
+typedef Sched_CheckpointedRunner<HillClimbing<Sched_Input, Sched_Output, Sched_UnionMove>> Sched_HillClimbing;
+
+// The last move made and its delta, that the stop criterion reads
+class Sched_SteepestDescent : public Sched_CheckpointedRunner<SteepestDescent<Sched_Input, Sched_Output, Sched_UnionMove>>
 {
 public:
-  Sched_SwapProfDeltaProfMaxWeeklyHours(const Sched_Input& in, Sched_ProfMaxWeeklyHours_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>(in,cc,"Sched_SwapProfDeltaProfMaxWeeklyHours") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const override;
+  using Sched_CheckpointedRunner<SteepestDescent<Sched_Input, Sched_Output, Sched_UnionMove>>::Sched_CheckpointedRunner;
+  bool ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const override;
+protected:
+  void SaveRunnerState(Sched_Checkpointer::Checkpoint& checkpoint) const override;
+  void RestoreRunnerState(const Sched_Checkpointer::Checkpoint& checkpoint) override;
 };
 
-class Sched_SwapProfDeltaScheduleContiguity
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>
+// The temperature and the neighbors sampled and accepted at the current temperature
+class Sched_SimulatedAnnealing : public Sched_CheckpointedRunner<SimulatedAnnealing<Sched_Input, Sched_Output, Sched_UnionMove>>
 {
 public:
-  Sched_SwapProfDeltaScheduleContiguity(const Sched_Input& in, Sched_ScheduleContiguity_CC& cc) 
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>(in,cc,"Sched_SwapProfDeltaScheduleContiguity") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const override { return 0; }  // SwapProf can't change this cost
+  using Sched_CheckpointedRunner<SimulatedAnnealing<Sched_Input, Sched_Output, Sched_UnionMove>>::Sched_CheckpointedRunner;
+  bool ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const override;
+protected:
+  void SaveRunnerState(Sched_Checkpointer::Checkpoint& checkpoint) const override;
+  void RestoreRunnerState(const Sched_Checkpointer::Checkpoint& checkpoint) override;
 };
 
-class Sched_SwapProfDeltaCompleteSolution
-  : public DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>
+// The tabu list: each move (with the index of its neighborhood) and the iteration at which it leaves the list
+class Sched_TabuSearch : public Sched_CheckpointedRunner<TabuSearch<Sched_Input, Sched_Output, Sched_UnionMove>>
 {
 public:
-  Sched_SwapProfDeltaCompleteSolution(const Sched_Input& in, Sched_SolutionComplete_CC& cc)
-    : DeltaCostComponent<Sched_Input,Sched_Output,Sched_SwapProf>(in,cc,"Sched_SwapProfDeltaCompleteSolution") 
-  {}
-  int ComputeDeltaCost(const Sched_Output& out, const Sched_SwapProf& mv) const override { return 0; }  // SwapProf can't change this cost
+  using Sched_CheckpointedRunner<TabuSearch<Sched_Input, Sched_Output, Sched_UnionMove>>::Sched_CheckpointedRunner;
+  bool ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const override;
+protected:
+  void SaveRunnerState(Sched_Checkpointer::Checkpoint& checkpoint) const override;
+  void RestoreRunnerState(const Sched_Checkpointer::Checkpoint& checkpoint) override;
+};
+
+/***************************************************************************
+ * Parallel Tempering (replica exchange simulated annealing)
+ ***************************************************************************/
+
+// Runs one simulated annealing chain per temperature of a geometric ladder, the chains are advanced
+// in parallel on the thread pool and every exchange_interval moves the states at neighboring temperatures
+// are swapped according to the Metropolis criterion (only the replica indices are exchanged). Each temperature
+// has its own generator, so a run depends only on the seed (unless the adaptive weights, shared by the chains, are on)
+class Sched_ParallelTempering
+{
+public:
+  Sched_ParallelTempering(const Sched_Input& in, Sched_SolutionManager& sm, NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_UnionMove>& nhe, Sched_ThreadPool& pool,
+                          unsigned replicas, double max_temperature, double min_temperature, unsigned long exchange_interval, unsigned long max_evaluations);
+  SolverResult<Sched_Input, Sched_Output> Solve();
+  SolverResult<Sched_Input, Sched_Output> Resolve(const Sched_Output& init);
+  // Goes on from a checkpoint of a run with the same setup (EasyLocal Random is restored by the caller)
+  SolverResult<Sched_Input, Sched_Output> Resume(const Sched_Checkpointer::Checkpoint& checkpoint);
+
+  // A checkpoint stores, after an exchange round, the state and the best state of each replica, the counters
+  // (evaluations, round, exchanges, replica_at) and the generators of the chains and of the exchanges
+  void SetCheckpointer(Sched_Checkpointer* pcheckpointer) { checkpointer = pcheckpointer; }
+
+  double Temperature(unsigned t) const { return temperatures[t]; }
+  unsigned long AcceptedExchanges() const { return accepted_exchanges; }
+  unsigned long AttemptedExchanges() const { return attempted_exchanges; }
+protected:
+  SolverResult<Sched_Input, Sched_Output> Run(vector<Sched_Output>& states, vector<Sched_Output>& best_states, vector<unsigned>& replica_at, vector<mt19937>& rngs, mt19937& exchange_rng,
+                                              unsigned long evaluations, unsigned long round, double elapsed);
+  void RunChain(Sched_Output& st, DefaultCostStructure<int>& cost, Sched_Output& best, DefaultCostStructure<int>& best_cost, double temperature, mt19937& rng, unsigned long steps);
+  void SubmitCheckpoint(const vector<Sched_Output>& states, const vector<Sched_Output>& best_states, const vector<unsigned>& replica_at, const vector<mt19937>& rngs, const mt19937& exchange_rng,
+                        unsigned long evaluations, unsigned long round, double elapsed);
+
+  const Sched_Input& in;
+  Sched_SolutionManager& sm;
+  NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_UnionMove>& nhe;
+  Sched_ThreadPool& pool;
+
+  unsigned replicas;
+  unsigned long exchange_interval;
+  unsigned long max_evaluations;
+  vector<double> temperatures;  // geometric ladder, from the highest to the lowest
+
+  unsigned long accepted_exchanges;
+  unsigned long attempted_exchanges;
+  Sched_Checkpointer* checkpointer;
+};
+
+/***************************************************************************
+ * Island Model (cooperative search with elite migration)
+ ***************************************************************************/
+
+// Each island runs its own chain on its own thread: island 0 is a hill climber, the others are simulated
+// annealing chains whose start temperatures span a geometric range. Every migration_interval moves an island
+// publishes its best state to its slot of the elite pool and adopts the best published state if it is better
+// than its own best. The slots are double-buffered, so neither publishing nor adopting ever waits on a lock.
+class Sched_IslandModel
+{
+public:
+  Sched_IslandModel(const Sched_Input& in, Sched_SolutionManager& sm, NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_UnionMove>& nhe,
+                    unsigned islands, double max_temperature, double min_temperature, unsigned long migration_interval, unsigned long max_evaluations);
+  SolverResult<Sched_Input, Sched_Output> Solve();
+  SolverResult<Sched_Input, Sched_Output> Resolve(const Sched_Output& init);
+
+  unsigned long Migrations() const { return migrations; }
+protected:
+  // Elite pool slot, written only by its island: the writer fills the buffer that is not published (if no reader
+  // is still copying it) and then flips published; a reader registers on the published buffer and gives up if it
+  // has been flipped in the meantime
+  struct EliteSlot
+  {
+    EliteSlot(const Sched_Input& in) : states{Sched_Output(in), Sched_Output(in)}, published(0), readers{0, 0}, best_total(numeric_limits<int>::max()) {}
+    Sched_Output states[2];
+    DefaultCostStructure<int> costs[2];
+    atomic<unsigned> published;
+    atomic<unsigned> readers[2];
+    atomic<int> best_total;   // cost of the published state (max int if none)
+  };
+
+  void RunIsland(unsigned i, const Sched_Output& init, unsigned seed);
+  bool Publish(EliteSlot& slot, const Sched_Output& st, const DefaultCostStructure<int>& cost);
+  bool Adopt(EliteSlot& slot, Sched_Output& st, DefaultCostStructure<int>& cost);
+
+  const Sched_Input& in;
+  Sched_SolutionManager& sm;
+  NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_UnionMove>& nhe;
+
+  unsigned islands;
+  unsigned long migration_interval;
+  unsigned long max_evaluations;
+  double min_temperature;
+  vector<double> start_temperatures;  // 0 for the hill climber
+
+  vector<unique_ptr<EliteSlot>> elite_pool;
+  vector<Sched_Output> best_states;
+  vector<DefaultCostStructure<int>> best_costs;
+
+  atomic<unsigned long> migrations;
+};
+
+/***************************************************************************
+ * Large Neighborhood Search (destroy and repair)
+ ***************************************************************************/
+
+// At each iteration frees a fraction of the lessons of a random slice of the current state (a day, a class or
+// a professor) and rebuilds it with the greedy repair of the solution manager; the new state replaces the
+// current one if it is not worse. Runs until the time budget or the iteration budget is spent.
+class Sched_LargeNeighborhoodSearch
+{
+public:
+  Sched_LargeNeighborhoodSearch(const Sched_Input& in, Sched_SolutionManager& sm, double destroy_fraction, double max_time, unsigned long max_iterations);
+  SolverResult<Sched_Input, Sched_Output> Solve();
+  SolverResult<Sched_Input, Sched_Output> Resolve(const Sched_Output& init);
+
+  unsigned long Iterations() const { return iterations; }
+  unsigned long AcceptedIterations() const { return accepted_iterations; }
+protected:
+  void Destroy(Sched_Output& st) const;
+
+  const Sched_Input& in;
+  Sched_SolutionManager& sm;
+
+  double destroy_fraction;  // share of the lessons of the slice that are freed
+  double max_time;          // seconds
+  unsigned long max_iterations;
+
+  unsigned long iterations;
+  unsigned long accepted_iterations;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+// File Sched_IslandModel.cc
+#include "Sched_Headers.hh"
+#include <cmath>
+#include <chrono>
+
+/***************************************************************************
+ * Island Model Code
+ ***************************************************************************/
+
+Sched_IslandModel::Sched_IslandModel(const Sched_Input& pin, Sched_SolutionManager& psm, NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_UnionMove>& pnhe,
+                                     unsigned n_islands, double max_temperature, double pmin_temperature, unsigned long interval, unsigned long evaluations)
+  : in(pin), sm(psm), nhe(pnhe), islands(n_islands), migration_interval(interval), max_evaluations(evaluations), min_temperature(pmin_temperature),
+    start_temperatures(n_islands, 0.0), migrations(0)
+{
+  unsigned i;
+
+  if (islands == 0 || migration_interval == 0)
+    throw runtime_error("Island model needs at least one island and a positive migration interval");
+  if (min_temperature <= 0 || max_temperature < min_temperature)
+    throw runtime_error("Island model needs 0 < min_temperature <= max_temperature");
+
+  // Island 0 is the hill climber, the start temperatures of the others go from max_temperature down to min_temperature
+  for (i = 1; i < islands; i++)
+    if (islands == 2)
+      start_temperatures[i] = max_temperature;
+    else
+      start_temperatures[i] = max_temperature * pow(min_temperature / max_temperature, double(i - 1) / (islands - 2));
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_IslandModel::Solve()
+{
+  Sched_Output init(in);
+
+  sm.RandomState(init);
+  return Resolve(init);
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_IslandModel::Resolve(const Sched_Output& init)
+{
+  unsigned i, best_i;
+  vector<thread> island_threads;
+  vector<unsigned> seeds(islands);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  elite_pool.clear();
+  for (i = 0; i < islands; i++)
+  {
+    elite_pool.push_back(make_unique<EliteSlot>(in));
+    seeds[i] = Random::Uniform<unsigned>(0, numeric_limits<unsigned>::max());
+  }
+  best_states.assign(islands, init);
+  best_costs.assign(islands, sm.CostFunctionComponents(init));
+  migrations = 0;
+
+  for (i = 0; i < islands; i++)
+    island_threads.emplace_back(&Sched_IslandModel::RunIsland, this, i, cref(init), seeds[i]);
+  for (i = 0; i < islands; i++)
+    island_threads[i].join();
+
+  best_i = 0;
+  for (i = 1; i < islands; i++)
+    if (best_costs[i] < best_costs[best_i])
+      best_i = i;
+
+  return SolverResult<Sched_Input, Sched_Output>(best_states[best_i], best_costs[best_i],
+                                                 chrono::duration<double>(chrono::steady_clock::now() - start).count());
+}
+
+void Sched_IslandModel::RunIsland(unsigned i, const Sched_Output& init, unsigned seed)
+{
+  unsigned j, elite;
+  unsigned long evaluations;
+  int elite_total;
+  double temperature = start_temperatures[i];
+  Sched_Output st = init;
+  DefaultCostStructure<int> cost = best_costs[i], delta;
+  Sched_UnionMove mv;
+  mt19937 rng(seed);
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  Sched_Random::ChainScope scope(rng);   // the moves of the island are drawn with its own generator
+
+  for (evaluations = 0; evaluations < max_evaluations; evaluations++)
+  {
+    if (evaluations > 0 && evaluations % migration_interval == 0)
+    {
+      Publish(*elite_pool[i], best_states[i], best_costs[i]);
+
+      // Adopt the best elite of the other islands, if it improves on the island's best
+      elite = i;
+      elite_total = best_costs[i].total;
+      for (j = 0; j < islands; j++)
+        if (j != i && elite_pool[j]->best_total.load() < elite_total)
+        {
+          elite = j;
+          elite_total = elite_pool[j]->best_total.load();
+        }
+      if (elite != i && Adopt(*elite_pool[elite], st, cost))
+      {
+        best_states[i] = st;
+        best_costs[i] = cost;
+        migrations++;
+      }
+
+      // Simulated annealing islands cool geometrically from their start temperature to min_temperature
+      if (temperature > 0)
+        temperature = start_temperatures[i] * pow(min_temperature / start_temperatures[i], double(evaluations) / max_evaluations);
+    }
+
+    try
+    {
+      nhe.RandomMove(st, mv);
+    }
+    catch (EmptyNeighborhood&)
+    {
+      break;
+    }
+
+    delta = nhe.DeltaCostFunctionComponents(st, mv);
+    if (delta.total <= 0 || (temperature > 0 && uniform(rng) < exp(-delta.total / temperature)))
+    {
+      nhe.MakeMove(st, mv);
+      cost += delta;
+      if (cost < best_costs[i])
+      {
+        best_states[i] = st;
+        best_costs[i] = cost;
+      }
+    }
+  }
+}
+
+// Writes the state in the unpublished buffer of the slot, skips the publication if a reader is still on it
+bool Sched_IslandModel::Publish(EliteSlot& slot, const Sched_Output& st, const DefaultCostStructure<int>& cost)
+{
+  unsigned b = 1 - slot.published.load();
+
+  if (cost.total >= slot.best_total.load() || slot.readers[b].load() != 0)
+    return false;
+
+  slot.states[b] = st;
+  slot.costs[b] = cost;
+  slot.published.store(b);
+  slot.best_total.store(cost.total);
+  return true;
+}
+
+// Copies the published state of the slot, fails if the writer flips the buffers during the registration
+bool Sched_IslandModel::Adopt(EliteSlot& slot, Sched_Output& st, DefaultCostStructure<int>& cost)
+{
+  unsigned p = slot.published.load();
+
+  slot.readers[p]++;
+  if (slot.published.load() != p || slot.best_total.load() == numeric_limits<int>::max())
+  {
+    slot.readers[p]--;
+    return false;
+  }
+
+  st = slot.states[p];
+  cost = slot.costs[p];
+  slot.readers[p]--;
+  return true;
+}
@@ -0,0 +1,226 @@
+// File Sched_KempeChain_NHE.cc
+#include "Sched_Headers.hh"
+
+/***************************************************************************
+ * Moves Code
+ ***************************************************************************/
+
+Sched_KempeChain::Sched_KempeChain()
+{
+  _class = -1;
+  day_1 = -1;
+  hour_1 = -1;
+  day_2 = -1;
+  hour_2 = -1;
+}
+
+bool operator==(const Sched_KempeChain& mv1, const Sched_KempeChain& mv2)
+{
+  return mv1._class == mv2._class && mv1.day_1 == mv2.day_1 && mv1.hour_1 == mv2.hour_1 && mv1.day_2 == mv2.day_2 && mv1.hour_2 == mv2.hour_2;
+}
+
+bool operator!=(const Sched_KempeChain& mv1, const Sched_KempeChain& mv2)
+{
+  return !(mv1 == mv2);
+}
+
+bool operator<(const Sched_KempeChain& mv1, const Sched_KempeChain& mv2)
+{
+  if (mv1.day_1 != mv2.day_1)
+    return mv1.day_1 < mv2.day_1;
+  else if (mv1.day_2 != mv2.day_2)
+    return mv1.day_2 < mv2.day_2;
+  else if (mv1._class != mv2._class)
+    return mv1._class < mv2._class;
+  else if (mv1.hour_1 != mv2.hour_1)
+    return mv1.hour_1 < mv2.hour_1;
+  else
+    return mv1.hour_2 < mv2.hour_2;
+}
+
+istream& operator>>(istream& is, Sched_KempeChain& mv)
+{
+  char ch;
+  is >> mv._class >> ch >> ch >> mv.day_1 >> ch >> mv.hour_1 >> ch >> ch >> ch >> ch >> ch >> mv.day_2 >> ch >> mv.hour_2 >> ch;
+  return is;
+}
+
+ostream& operator<<(ostream& os, const Sched_KempeChain& mv)
+{
+  os << mv._class << ": (" << mv.day_1 << ", " << mv.hour_1 << ") <=> (" << mv.day_2 << ", " << mv.hour_2 << ")";
+  return os;
+}
+
+/***************************************************************************
+ * Sched_KempeChain Neighborhood Explorer Code
+ ***************************************************************************/
+
+void Sched_KempeChain_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sched_KempeChain& mv) const
+{
+  SCHED_PROFILE(KEMPE_CHAIN, RANDOM_MOVE);
+
+  thread_local vector<unsigned> chain;
+  unsigned max_iterations = 10 * in.N_Classes() * in.N_Days() * in.N_HoursXDay();
+  unsigned iterations, n_slots = in.N_Days() * in.N_HoursXDay();
+  unsigned slot_1, slot_2;
+  uint64_t hours;
+
+  if (in.N_Classes() < 3 || n_slots < 2)  // A chain needs three classes and two hours
+    throw EmptyNeighborhood();
+
+  // Draws a busy hour of a class and another hour, then puts the chain in canonical form
+  for (iterations = 0; iterations < max_iterations; iterations++)
+  {
+    mv._class = Sched_Random::Uniform<int>(0, in.N_Classes() - 1);
+    hours = out.ClassMask(mv._class);
+    if (hours == 0)
+      continue;
+
+    slot_1 = Sched_Output::NthHour(hours, Sched_Random::Uniform<unsigned>(0, popcount(hours) - 1));
+    slot_2 = Sched_Random::Uniform<unsigned>(0, n_slots - 2);
+    if (slot_2 >= slot_1)
+      slot_2++;
+    if (slot_1 > slot_2)
+      swap(slot_1, slot_2);
+
+    out.KempeChain(mv._class, slot_1 / in.N_HoursXDay(), slot_1 % in.N_HoursXDay(), slot_2 / in.N_HoursXDay(), slot_2 % in.N_HoursXDay(), chain);
+    if (chain.size() < 3)
+      continue;
+
+    mv._class = *min_element(chain.begin(), chain.end());
+    mv.day_1 = slot_1 / in.N_HoursXDay();
+    mv.hour_1 = slot_1 % in.N_HoursXDay();
+    mv.day_2 = slot_2 / in.N_HoursXDay();
+    mv.hour_2 = slot_2 % in.N_HoursXDay();
+    return;
+  }
+
+  throw EmptyNeighborhood();
+}
+
+bool Sched_KempeChain_NeighborhoodExplorer::FeasibleMove(const Sched_Output& out, const Sched_KempeChain& mv) const
+{
+  SCHED_PROFILE(KEMPE_CHAIN, FEASIBLE_MOVE);
+
+  thread_local vector<unsigned> chain;
+
+  if (mv.day_1 > mv.day_2 || (mv.day_1 == mv.day_2 && mv.hour_1 >= mv.hour_2))
+    SCHED_PROFILE_RETURN(false);
+
+  // The chain never creates clashes: it must only be long enough and start from its lowest class
+  out.KempeChain(mv._class, mv.day_1, mv.hour_1, mv.day_2, mv.hour_2, chain);
+
+  SCHED_PROFILE_RETURN(chain.size() >= 3 && *min_element(chain.begin(), chain.end()) == (unsigned)mv._class);
+}
+
+void Sched_KempeChain_NeighborhoodExplorer::MakeMove(Sched_Output& out, const Sched_KempeChain& mv) const
+{
+  SCHED_PROFILE(KEMPE_CHAIN, MAKE_MOVE);
+
+  vector<unsigned> chain;
+
+  out.KempeChain(mv._class, mv.day_1, mv.hour_1, mv.day_2, mv.hour_2, chain);
+  out.SwapHoursInClasses(chain, mv.day_1, mv.hour_1, mv.day_2, mv.hour_2);
+}
+
+void Sched_KempeChain_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sched_KempeChain& mv) const
+{
+  unsigned b;
+
+  for (b = 0; b < N_Blocks(); b++)
+    if (FirstMoveInBlock(out, mv, b))
+      return;
+
+  throw EmptyNeighborhood();
+}
+
+bool Sched_KempeChain_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sched_KempeChain& mv) const
+{
+  SCHED_PROFILE(KEMPE_CHAIN, NEXT_MOVE);
+
+  do
+  {
+    if (!AnyNextMove(out, mv))
+      return false;
+  } while (!FeasibleMove(out, mv));
+
+  return true;
+}
+
+bool Sched_KempeChain_NeighborhoodExplorer::FirstMoveInBlock(const Sched_Output& out, Sched_KempeChain& mv, unsigned b) const
+{
+  SCHED_PROFILE(KEMPE_CHAIN, FIRST_MOVE_IN_BLOCK);
+
+  // Days of the block
+  for (mv.day_1 = 0; Block(mv.day_1, in.N_Days() - 1) < b; mv.day_1++)
+    ;
+  mv.day_2 = mv.day_1 + (b - Block(mv.day_1, mv.day_1));
+
+  if (in.N_Classes() < 3 || (mv.day_1 == mv.day_2 && in.N_HoursXDay() < 2))
+    return false;
+
+  mv._class = 0;
+  mv.hour_1 = 0;
+  mv.hour_2 = mv.day_1 == mv.day_2 ? 1 : 0;
+
+  while (!FeasibleMove(out, mv))
+  {
+    if (!AnyNextMove(out, mv) || Block(mv.day_1, mv.day_2) != b)
+      return false;
+  }
+
+  return true;
+}
+
+bool Sched_KempeChain_NeighborhoodExplorer::NextMoveInBlock(const Sched_Output& out, Sched_KempeChain& mv) const
+{
+  SCHED_PROFILE(KEMPE_CHAIN, NEXT_MOVE_IN_BLOCK);
+
+  unsigned b = Block(mv.day_1, mv.day_2);
+
+  do
+  {
+    if (!AnyNextMove(out, mv) || Block(mv.day_1, mv.day_2) != b)
+      return false;
+  } while (!FeasibleMove(out, mv));
+
+  return true;
+}
+
+// The moves are enumerated by pair of days, class, hour_1 and hour_2
+bool Sched_KempeChain_NeighborhoodExplorer::AnyNextMove(const Sched_Output& out, Sched_KempeChain& mv) const
+{
+  mv.hour_2++;
+
+  while (mv.hour_2 >= (int)in.N_HoursXDay())
+  {
+    if (++mv.hour_1 < (int)in.N_HoursXDay())
+    {
+      mv.hour_2 = mv.day_1 == mv.day_2 ? mv.hour_1 + 1 : 0;
+      continue;
+    }
+
+    // Pruning: the chains of a class that has no lessons in the two days contain only that class
+    do
+      mv._class++;
+    while (mv._class < (int)in.N_Classes()
+           && ((out.ClassMask(mv._class) >> (mv.day_1 * in.N_HoursXDay())) & out.DayMask()) == 0
+           && ((out.ClassMask(mv._class) >> (mv.day_2 * in.N_HoursXDay())) & out.DayMask()) == 0);
+
+    if (mv._class >= (int)in.N_Classes())
+    {
+      mv._class = 0;
+      if (++mv.day_2 >= (int)in.N_Days())
+      {
+        if (++mv.day_1 >= (int)in.N_Days())
+          return false;
+        mv.day_2 = mv.day_1;
+      }
+    }
+
+    mv.hour_1 = 0;
+    mv.hour_2 = mv.day_1 == mv.day_2 ? 1 : 0;
+  }
+
+  return true;
+}
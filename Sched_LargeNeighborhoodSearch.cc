@@ -0,0 +1,102 @@
+// File Sched_LargeNeighborhoodSearch.cc
+#include "Sched_Headers.hh"
+#include <cmath>
+#include <chrono>
+
+/***************************************************************************
+ * Large Neighborhood Search Code
+ ***************************************************************************/
+
+Sched_LargeNeighborhoodSearch::Sched_LargeNeighborhoodSearch(const Sched_Input& pin, Sched_SolutionManager& psm, double fraction, double time, unsigned long pmax_iterations)
+  : in(pin), sm(psm), destroy_fraction(fraction), max_time(time), max_iterations(pmax_iterations), iterations(0), accepted_iterations(0)
+{
+  if (destroy_fraction <= 0 || destroy_fraction > 1)
+    throw runtime_error("Large neighborhood search needs 0 < destroy_fraction <= 1");
+  if (max_time <= 0)
+    throw runtime_error("Large neighborhood search needs a positive time budget");
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_LargeNeighborhoodSearch::Solve()
+{
+  Sched_Output init(in);
+
+  sm.RandomState(init);
+  return Resolve(init);
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_LargeNeighborhoodSearch::Resolve(const Sched_Output& init)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  Sched_Output current(init), best(init), st(in);
+  DefaultCostStructure<int> current_cost = sm.CostFunctionComponents(init), best_cost = current_cost, cost;
+
+  iterations = 0;
+  accepted_iterations = 0;
+
+  while (iterations < max_iterations && chrono::duration<double>(chrono::steady_clock::now() - start).count() < max_time)
+  {
+    iterations++;
+
+    st = current;
+    Destroy(st);
+    sm.RepairState(st);
+    cost = sm.CostFunctionComponents(st);
+
+    // Sideways steps are accepted, so that the search can drift on plateaus
+    if (cost <= current_cost)
+    {
+      swap(current, st);
+      current_cost = cost;
+      accepted_iterations++;
+
+      if (current_cost < best_cost)
+      {
+        best = current;
+        best_cost = current_cost;
+      }
+    }
+  }
+
+  return SolverResult<Sched_Input, Sched_Output>(best, best_cost, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+}
+
+// Frees a random share (destroy_fraction, at least one lesson) of the lessons of a random day, class or professor
+void Sched_LargeNeighborhoodSearch::Destroy(Sched_Output& st) const
+{
+  unsigned c, d, h, p, i, n_freed;
+  vector<tuple<unsigned, unsigned, unsigned>> lessons;  // class, day, hour
+
+  switch (Random::Uniform<int>(0, 2))
+  {
+    case 0:  // day
+      d = Random::Uniform<unsigned>(0, in.N_Days() - 1);
+      for (c = 0; c < in.N_Classes(); c++)
+        for (h = 0; h < in.N_HoursXDay(); h++)
+          if (!st.IsClassHourFree(c, d, h))
+            lessons.emplace_back(c, d, h);
+      break;
+    case 1:  // class
+      c = Random::Uniform<unsigned>(0, in.N_Classes() - 1);
+      for (d = 0; d < in.N_Days(); d++)
+        for (h = 0; h < in.N_HoursXDay(); h++)
+          if (!st.IsClassHourFree(c, d, h))
+            lessons.emplace_back(c, d, h);
+      break;
+    default:  // professor
+      p = Random::Uniform<unsigned>(0, in.N_Profs() - 1);
+      for (d = 0; d < in.N_Days(); d++)
+        for (h = 0; h < in.N_HoursXDay(); h++)
+          if (st.Prof_Schedule(p, d, h) != -1)
+            lessons.emplace_back(st.Prof_Schedule(p, d, h), d, h);
+      break;
+  }
+
+  if (lessons.empty())
+    return;
+
+  shuffle(lessons.begin(), lessons.end(), Random::GetGenerator());
+  n_freed = max(1u, (unsigned)ceil(destroy_fraction * lessons.size()));
+
+  for (i = 0; i < n_freed && i < lessons.size(); i++)
+    st.FreeHour(get<0>(lessons[i]), get<1>(lessons[i]), get<2>(lessons[i]));
+}
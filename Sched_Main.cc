@@ -1,15 +1,256 @@
 #include "Sched_Headers.hh"
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+#include <sys/wait.h>
 
 using namespace EasyLocal::Debug;
 
+namespace
+{
+  // Statistics of a single run of the multi-start mode
+  struct RunStatistics
+  {
+    int seed;
+    int cost;
+    int violations;
+    vector<int> components;
+    double time;
+  };
+
+  // Help function: reads a state from a binary snapshot or from a text file, false (with a message) if it cannot
+  bool ReadState(const string& filename, Sched_Output& out)
+  {
+    if (Sched_Output::IsSnapshot(filename))
+    {
+      try
+      {
+        out.ReadSnapshot(filename);
+      }
+      catch (const runtime_error& e)
+      {
+        cerr << filename << ": " << e.what() << endl;
+        return false;
+      }
+      return true;
+    }
+
+    ifstream is(filename);
+    if (!(is >> out))
+    {
+      cerr << "Cannot read initial state " << filename << endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Multi-start help function: runs a trajectory in a child process, so that each run has its own random generator
+  // and EasyLocal runner state while the instance is shared. The child writes its statistics and its final solution
+  // to result_filename. Returns the pid of the child (-1 if the process cannot be created).
+  pid_t StartRun(const function<SolverResult<Sched_Input, Sched_Output>(const Sched_Output&)>& solve, Sched_SolutionManager& sm, const Sched_Input& in,
+                 int seed, const string& init_method, const string& init_state_filename, const string& result_filename)
+  {
+    pid_t pid;
+    unsigned i;
+
+    cout.flush();
+    pid = fork();
+    if (pid != 0)
+      return pid;
+
+    Random::SetSeed(seed);
+
+    Sched_Output init(in);
+    if (init_state_filename != "")
+    {
+      if (!ReadState(init_state_filename, init))
+        _exit(1);
+    }
+    else if (init_method == "Greedy")
+      sm.GreedyState(init);
+    else
+      sm.RandomState(init);
+
+    SolverResult<Sched_Input, Sched_Output> result = solve(init);
+
+    ofstream os(result_filename);
+    os << result.cost.total << " " << result.cost.violations << " " << result.running_time << " " << result.cost.all_components.size();
+    for (i = 0; i < result.cost.all_components.size(); i++)
+      os << " " << result.cost.all_components[i];
+    os << endl << result.output;
+    os.close();
+
+    _exit(os ? 0 : 1);
+  }
+
+  // Multi-start help function: reads the statistics and the solution written by a run
+  bool ReadRun(const string& result_filename, RunStatistics& run, Sched_Output& out)
+  {
+    unsigned i, n_components;
+    ifstream is(result_filename);
+
+    if (!(is >> run.cost >> run.violations >> run.time >> n_components))
+      return false;
+
+    run.components.resize(n_components);
+    for (i = 0; i < n_components; i++)
+      is >> run.components[i];
+
+    is >> out;
+    return true;
+  }
+
+  // Runs 'restarts' independent trajectories, at most 'parallel_runs' at the same time, and reports the best one
+  int MultiStartSolve(const function<SolverResult<Sched_Input, Sched_Output>(const Sched_Output&)>& solve, Sched_SolutionManager& sm, const Sched_Input& in,
+                      unsigned restarts, unsigned parallel_runs, int base_seed, const string& init_method, const string& init_state_filename,
+                      const string& output_filename)
+  {
+    unsigned r, next_run = 0, running = 0, best_run = restarts;
+    int status, fd;
+    pid_t pid;
+    vector<pid_t> run_pid(restarts, -1);
+    vector<string> run_filename(restarts);
+    vector<RunStatistics> runs(restarts);
+    vector<bool> run_ok(restarts, false);
+    Sched_Output out(in), best_out(in);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double wall_time;
+
+    while (next_run < restarts || running > 0)
+    {
+      // Launch runs until all the slots are busy
+      while (next_run < restarts && running < parallel_runs)
+      {
+        run_filename[next_run] = (filesystem::temp_directory_path() / "sched_run_XXXXXX").string();
+        fd = mkstemp(run_filename[next_run].data());
+        if (fd == -1)
+        {
+          cerr << "Cannot create temporary file for run " << next_run << endl;
+          exit(1);
+        }
+        close(fd);
+
+        runs[next_run].seed = base_seed + next_run;
+        run_pid[next_run] = StartRun(solve, sm, in, runs[next_run].seed, init_method, init_state_filename, run_filename[next_run]);
+        if (run_pid[next_run] == -1)
+        {
+          cerr << "Cannot start run " << next_run << endl;
+          exit(1);
+        }
+
+        next_run++;
+        running++;
+      }
+
+      // Collect a finished run
+      pid = wait(&status);
+      if (pid == -1)
+        break;
+
+      for (r = 0; r < restarts && run_pid[r] != pid; r++);
+      if (r == restarts)
+        continue;
+
+      running--;
+      run_ok[r] = WIFEXITED(status) && WEXITSTATUS(status) == 0 && ReadRun(run_filename[r], runs[r], out);
+      remove(run_filename[r].c_str());
+
+      if (run_ok[r] && (best_run == restarts || runs[r].cost < runs[best_run].cost))
+      {
+        best_run = r;
+        best_out = out;
+      }
+    }
+
+    wall_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (best_run == restarts)
+    {
+      cerr << "All runs failed" << endl;
+      return 1;
+    }
+
+    ofstream file_os;
+    if (output_filename != "")
+      file_os.open(output_filename);
+    ostream& os = output_filename != "" ? file_os : cout;
+
+    if (output_filename == "")
+      os << best_out << endl;
+
+    os << "Cost:\t" << runs[best_run].cost << endl
+       << "Violations:\t " << runs[best_run].violations << endl
+       << "ProfUnavailability:\t" << runs[best_run].components[0] << endl
+       << "MaxHoursXDay:\t" << runs[best_run].components[1] << endl
+       << "ProfMaxWeeklyHours:\t" << runs[best_run].components[2] << endl
+       << "ScheduleContiguity:\t" << runs[best_run].components[3] << endl;
+    os << "Time:\t" << runs[best_run].time << "\ts" << endl;
+    os << "BestRun:\t" << best_run << endl;
+    os << "WallTime:\t" << wall_time << "\ts" << endl;
+
+    // Per-run statistics
+    os << "Run\tSeed\tCost\tViolations\tTime" << endl;
+    for (r = 0; r < restarts; r++)
+    {
+      os << r << "\t" << runs[r].seed << "\t";
+      if (run_ok[r])
+        os << runs[r].cost << "\t" << runs[r].violations << "\t" << runs[r].time << endl;
+      else
+        os << "failed" << endl;
+    }
+
+    return 0;
+  }
+}
+
 int main(int argc, const char* argv[])
 {
   ParameterBox main_parameters("main", "Main Program options");
   Parameter<string> instance("instance", "Input instance", main_parameters); 
+  Parameter<bool> instance_cache("instance_cache", "Read the instance from its compiled copy <instance>.schedbin, written at the first run and rebuilt when the instance changes (default false)", main_parameters);
   Parameter<int> seed("seed", "Random seed", main_parameters);
   Parameter<string> method("method", "Solution method (empty for tester)", main_parameters);   
-  Parameter<string> init_state("init_state", "Initial state (to be read from file)", main_parameters);
+  Parameter<string> init_state("init_state", "Initial state (to be read from file, as text or as a binary snapshot)", main_parameters);
   Parameter<string> output_file("output_file", "Write the output to a file (filename required)", main_parameters);
+  Parameter<string> save_snapshot("save_snapshot", "Write the solution of a single run as a binary snapshot (to be used as init_state)", main_parameters);
+  Parameter<unsigned int> threads("threads", "Number of threads: for the neighborhood evaluation of SD and TS and the chains of PT, or with restarts for the runs at the same time (each run then evaluates its neighborhood on a single thread) (default 1)", main_parameters);
+  Parameter<unsigned int> restarts("restarts", "Number of independent runs, the best one is reported: each run is a child process with its own seed (base seed + run) and sends back its solution and statistics in a temporary file; trajectory, checkpoints and run statistics are not available (default 1)", main_parameters);
+  Parameter<string> init_method("init_method", "Initial state of each restart: Random (default) or Greedy", main_parameters);
+  Parameter<bool> incremental("incremental", "SD and TS re-evaluate only the moves affected by the last move (default false)", main_parameters);
+  Parameter<bool> cross_swap_hours("cross_swap_hours", "Add the CrossSwapHours moves (a professor exchanges the hours of his lessons in two classes) to the neighborhood (default false)", main_parameters);
+  Parameter<bool> kempe_chain("kempe_chain", "Add the KempeChain moves (two hours swapped in a chain of classes sharing professors) to the neighborhood (default false)", main_parameters);
+  Parameter<double> violation_bias("violation_bias", "Probability that a random SwapHours move starts from an hour involved in a violation (default 0)", main_parameters);
+  Parameter<bool> statistics("statistics", "Print the moves made, the delta evaluations and the time to the best cost of a single run (default false)", main_parameters);
+  Parameter<bool> adaptive_selection("adaptive_selection", "Random moves choose the neighborhood by its recent improvement per microsecond, the statistics are printed at the end (default false)", main_parameters);
+  Parameter<unsigned long int> adaptive_segment("adaptive_segment", "Random moves between two updates of the neighborhood weights (default 1000)", main_parameters);
+  Parameter<string> trajectory_file("trajectory_file", "Stream the cost trajectory of a single HC, SD, SA or TS run (new best costs and samples) to a file", main_parameters);
+  Parameter<string> trajectory_format("trajectory_format", "Format of the trajectory file: CSV (default) or Binary", main_parameters);
+  Parameter<unsigned long int> trajectory_sample("trajectory_sample", "Moves between two samples of the trajectory (default 10000)", main_parameters);
+  Parameter<string> checkpoint_file("checkpoint_file", "Save checkpoints of a single HC, SD, SA, TS or PT run to a file, removed when the run ends", main_parameters);
+  Parameter<double> checkpoint_interval("checkpoint_interval", "Seconds between two checkpoints (default 600)", main_parameters);
+  Parameter<bool> resume("resume", "Go on from the checkpoint file, if it exists, with the same method and instance (default false)", main_parameters);
+  Parameter<string> profile_file("profile_file", "Write the profiling report as JSON to a file (only with make PROFILE=1)", main_parameters);
+
+  ParameterBox pt_parameters("PT", "Parallel tempering options");
+  Parameter<unsigned int> pt_replicas("replicas", "Number of replicas (default 8)", pt_parameters);
+  Parameter<double> pt_max_temperature("max_temperature", "Highest temperature of the ladder (default 20)", pt_parameters);
+  Parameter<double> pt_min_temperature("min_temperature", "Lowest temperature of the ladder (default 0.5)", pt_parameters);
+  Parameter<unsigned long int> pt_exchange_interval("exchange_interval", "Moves of each replica between two exchanges (default 1000)", pt_parameters);
+  Parameter<unsigned long int> pt_max_evaluations("max_evaluations", "Moves of each replica (default 1000000)", pt_parameters);
+
+  ParameterBox im_parameters("IM", "Island model options");
+  Parameter<unsigned int> im_islands("islands", "Number of islands, island 0 is a hill climber (default 4)", im_parameters);
+  Parameter<double> im_max_temperature("max_temperature", "Highest start temperature of the annealing islands (default 20)", im_parameters);
+  Parameter<double> im_min_temperature("min_temperature", "Lowest (and final) temperature of the annealing islands (default 0.5)", im_parameters);
+  Parameter<unsigned long int> im_migration_interval("migration_interval", "Moves of each island between two migrations (default 10000)", im_parameters);
+  Parameter<unsigned long int> im_max_evaluations("max_evaluations", "Moves of each island (default 1000000)", im_parameters);
+
+  ParameterBox lns_parameters("LNS", "Large neighborhood search options");
+  Parameter<double> lns_destroy_fraction("destroy_fraction", "Share of the lessons of the chosen day, class or professor freed at each iteration (default 0.3)", lns_parameters);
+  Parameter<double> lns_max_time("max_time", "Time budget in seconds (default 60)", lns_parameters);
+  Parameter<unsigned long int> lns_max_iterations("max_iterations", "Destroy and repair iterations (default 1000000)", lns_parameters);
  
   // 3rd parameter: false = do not check unregistered parameters
   // 4th parameter: true = silent
@@ -21,10 +262,13 @@ int main(int argc, const char* argv[])
     return 1;
   }
 
-  Sched_Input in(instance);
+  Sched_Input in(instance, instance_cache.IsSet() && instance_cache);
 
   if (seed.IsSet())
     Random::SetSeed(seed);
+
+  // With restarts the threads run whole trajectories (in separate processes), so the neighborhood evaluation is sequential
+  Sched_ThreadPool pool(threads.IsSet() && threads > 0 && !(restarts.IsSet() && restarts > 1) ? (unsigned)threads : 1);
   
   // Cost Components: second parameter is the cost, third is the type (true -> hard, false -> soft)
   Sched_ProfUnavailability_CC cc_PU(in, in.UnavailabilityViolationCost(), false);
@@ -33,30 +277,19 @@ int main(int argc, const char* argv[])
   Sched_ScheduleContiguity_CC cc_SC(in, in.ScheduleContiguityViolationCost(), false);
   Sched_SolutionComplete_CC cc_CS(in, 1, true);
  
-  //  Delta Cost Components
-  Sched_SwapHoursDeltaProfUnavailability SwapH_dcc_PU(in, cc_PU);
-  Sched_SwapHoursDeltaMaxSubjectHoursXDay SwapH_dcc_MSHD(in, cc_MSHD);
-  Sched_SwapHoursDeltaProfMaxWeeklyHours SwapH_dcc_PMWH(in, cc_PWMH);
-  Sched_SwapHoursDeltaScheduleContiguity SwapH_dcc_SC(in, cc_SC);
-  Sched_SwapHoursDeltaCompleteSolution SwapH_dcc_CS(in, cc_CS);
-
-  Sched_AssignProfDeltaProfUnavailability  AssignP_dcc_PU(in, cc_PU);
-  Sched_AssignProfDeltaMaxSubjectHoursXDay AssignP_dcc_MSHD(in, cc_MSHD);
-  Sched_AssignProfDeltaProfMaxWeeklyHours AssignP_dcc_PMWH(in, cc_PWMH);
-  Sched_AssignProfDeltaScheduleContiguity AssignP_dcc_SC(in, cc_SC);
-  Sched_AssignProfDeltaCompleteSolution AssignP_dcc_CS(in, cc_CS);
-
-  Sched_SwapProfDeltaProfUnavailability  SwapP_dcc_PU(in, cc_PU);
-  Sched_SwapProfDeltaMaxSubjectHoursXDay SwapP_dcc_MSHD(in, cc_MSHD);
-  Sched_SwapProfDeltaProfMaxWeeklyHours SwapP_dcc_PMWH(in, cc_PWMH);
-  Sched_SwapProfDeltaScheduleContiguity SwapP_dcc_SC(in, cc_SC);
-  Sched_SwapProfDeltaCompleteSolution SwapP_dcc_CS(in, cc_CS);
+  // Delta cost of the moves of all the explorers (the components are added to the state manager in the same order)
+  Sched_DeltaCost delta_cost(in, cc_PU, cc_MSHD, cc_PWMH, cc_SC, cc_CS);
 
   // helpers
   Sched_SolutionManager Sched_sm(in);
-  Sched_SwapHours_NeighborhoodExplorer Sched_SwapH_nhe(in, Sched_sm);
-  Sched_AssignProf_NeighborhoodExplorer Sched_AssignP_nhe(in, Sched_sm);
-  Sched_SwapProf_NeighborhoodExplorer Sched_SwapP_nhe(in, Sched_sm);
+  Sched_SwapHours_NeighborhoodExplorer Sched_SwapH_nhe(in, Sched_sm, delta_cost);
+  Sched_AssignProf_NeighborhoodExplorer Sched_AssignP_nhe(in, Sched_sm, delta_cost);
+  Sched_SwapProf_NeighborhoodExplorer Sched_SwapP_nhe(in, Sched_sm, delta_cost);
+  Sched_CrossSwapHours_NeighborhoodExplorer Sched_CrossH_nhe(in, Sched_sm, delta_cost);
+  Sched_KempeChain_NeighborhoodExplorer Sched_Kempe_nhe(in, Sched_sm, delta_cost);
+
+  if (violation_bias.IsSet())
+    Sched_SwapH_nhe.SetViolationBias(violation_bias);
   
   // All cost components must be added to the state manager
   Sched_sm.AddCostComponent(cc_PU);
@@ -65,36 +298,23 @@ int main(int argc, const char* argv[])
   Sched_sm.AddCostComponent(cc_SC);
   Sched_sm.AddCostComponent(cc_CS);
 
-  // Add all delta cost components for SwapHour to the neighborhood explorer
-  Sched_SwapH_nhe.AddDeltaCostComponent(SwapH_dcc_PU);
-  Sched_SwapH_nhe.AddDeltaCostComponent(SwapH_dcc_MSHD);
-  Sched_SwapH_nhe.AddDeltaCostComponent(SwapH_dcc_PMWH);
-  Sched_SwapH_nhe.AddDeltaCostComponent(SwapH_dcc_SC);
-  Sched_SwapH_nhe.AddDeltaCostComponent(SwapH_dcc_CS);
-
-  // Add all delta cost components for AssignProf to the neighborhood explorer
-  Sched_AssignP_nhe.AddDeltaCostComponent(AssignP_dcc_PU);
-  Sched_AssignP_nhe.AddDeltaCostComponent(AssignP_dcc_MSHD);
-  Sched_AssignP_nhe.AddDeltaCostComponent(AssignP_dcc_PMWH);
-  Sched_AssignP_nhe.AddDeltaCostComponent(AssignP_dcc_SC);
-  Sched_AssignP_nhe.AddDeltaCostComponent(AssignP_dcc_CS);
-
-  // Add all delta cost components for SwapProf to the neighborhood explorer
-  Sched_SwapP_nhe.AddDeltaCostComponent(SwapP_dcc_PU);
-  Sched_SwapP_nhe.AddDeltaCostComponent(SwapP_dcc_MSHD);
-  Sched_SwapP_nhe.AddDeltaCostComponent(SwapP_dcc_PMWH);
-  Sched_SwapP_nhe.AddDeltaCostComponent(SwapP_dcc_SC);
-  Sched_SwapP_nhe.AddDeltaCostComponent(SwapP_dcc_CS);
-
-  // Union of neighborhoods creation
-  SetUnionNeighborhoodExplorer <Sched_Input, Sched_Output, DefaultCostStructure<int>, Sched_SwapHours_NeighborhoodExplorer, Sched_AssignProf_NeighborhoodExplorer, Sched_SwapProf_NeighborhoodExplorer> Union_nhe(in, Sched_sm, "Union NHE", Sched_SwapH_nhe, Sched_AssignP_nhe, Sched_SwapP_nhe);
+  // Union of neighborhoods creation (SelectBest is evaluated on the thread pool)
+  Sched_ParallelUnion_NeighborhoodExplorer Union_nhe(in, Sched_sm, "Union NHE", Sched_SwapH_nhe, Sched_AssignP_nhe, Sched_SwapP_nhe, Sched_CrossH_nhe, Sched_Kempe_nhe, pool);
+  Union_nhe.SetNeighborhoodEnabled(3, cross_swap_hours.IsSet() && cross_swap_hours);
+  Union_nhe.SetNeighborhoodEnabled(4, kempe_chain.IsSet() && kempe_chain);
+  unique_ptr<Sched_AdaptiveSelection> adaptive;
+  if (adaptive_selection.IsSet() && adaptive_selection)
+  {
+    adaptive = make_unique<Sched_AdaptiveSelection>(adaptive_segment.IsSet() ? (unsigned long)adaptive_segment : 1000);
+    Union_nhe.SetAdaptiveSelection(adaptive.get());
+  }
   
   // Runners
   // Union
-  HillClimbing<Sched_Input, Sched_Output, tuple <ActiveMove<Sched_SwapHours>, ActiveMove<Sched_AssignProf>, ActiveMove<Sched_SwapProf>>> Sched_hc(in, Sched_sm, Union_nhe, "HC");
-  SteepestDescent<Sched_Input, Sched_Output, tuple <ActiveMove<Sched_SwapHours>, ActiveMove<Sched_AssignProf>, ActiveMove<Sched_SwapProf>>> Sched_sd(in, Sched_sm, Union_nhe, "SD");
-  SimulatedAnnealing<Sched_Input, Sched_Output, tuple <ActiveMove<Sched_SwapHours>, ActiveMove<Sched_AssignProf>, ActiveMove<Sched_SwapProf>>> Sched_sa(in, Sched_sm, Union_nhe, "SA");
-  TabuSearch<Sched_Input, Sched_Output, tuple <ActiveMove<Sched_SwapHours>, ActiveMove<Sched_AssignProf>, ActiveMove<Sched_SwapProf>>> Sched_ts(in, Sched_sm, Union_nhe, "TS");
+  Sched_HillClimbing Sched_hc(in, Sched_sm, Union_nhe, "HC");
+  Sched_SteepestDescent Sched_sd(in, Sched_sm, Union_nhe, "SD");
+  Sched_SimulatedAnnealing Sched_sa(in, Sched_sm, Union_nhe, "SA");
+  Sched_TabuSearch Sched_ts(in, Sched_sm, Union_nhe, "TS");
 
   // SwapProf
   //HillClimbing<Sched_Input, Sched_Output, Sched_SwapProf> Sched_hc(in, Sched_sm, Sched_SwapP_nhe, "HC");
@@ -116,6 +336,8 @@ int main(int argc, const char* argv[])
   MoveTester<Sched_Input, Sched_Output, Sched_SwapHours> swapH_move_test(in, Sched_sm, Sched_SwapH_nhe, "Sched_SwapHours move", tester);
   MoveTester<Sched_Input, Sched_Output, Sched_AssignProf> assignP_move_test(in, Sched_sm, Sched_AssignP_nhe, "Sched_AssignProf move", tester); 
   MoveTester<Sched_Input, Sched_Output, Sched_SwapProf> swapP_move_test(in, Sched_sm, Sched_SwapP_nhe, "Sched_SwapProf move", tester);
+  MoveTester<Sched_Input, Sched_Output, Sched_CrossSwapHours> crossH_move_test(in, Sched_sm, Sched_CrossH_nhe, "Sched_CrossSwapHours move", tester);
+  MoveTester<Sched_Input, Sched_Output, Sched_KempeChain> kempe_move_test(in, Sched_sm, Sched_Kempe_nhe, "Sched_KempeChain move", tester);
 
   SimpleLocalSearch<Sched_Input, Sched_Output> Sched_solver(in, Sched_sm, "Sched_solver");
   if (!CommandLineParameters::Parse(argc, argv, true, false))
@@ -130,30 +352,187 @@ int main(int argc, const char* argv[])
   }
   else
   {
+    Sched_RunnerCheckpoints* runner_checkpoints = nullptr;
     if (method == "SA")
     {
       Sched_solver.SetRunner(Sched_sa);
+      runner_checkpoints = &Sched_sa;
     }
     else if (method == "HC")
     {
       Sched_solver.SetRunner(Sched_hc);
+      runner_checkpoints = &Sched_hc;
     }
     else if (method == "SD")
     {
       Sched_solver.SetRunner(Sched_sd);
+      runner_checkpoints = &Sched_sd;
+      Union_nhe.SetIncremental(incremental.IsSet() && incremental);
     }
     else if (method == "TS")
     {
       Sched_solver.SetRunner(Sched_ts);
+      runner_checkpoints = &Sched_ts;
+      Union_nhe.SetIncremental(incremental.IsSet() && incremental);
     }
-    else
+    else if (method != "PT" && method != "IM" && method != "LNS")
     {
       cerr << "Unknown method " << static_cast<string>(method) << endl;
       exit(1);
     }
 
-    SolverResult<Sched_Input, Sched_Output> result = Sched_solver.Solve();
+    // Parallel tempering runs its replicas on the thread pool and the island model its islands on their own
+    // threads, both out of the EasyLocal solver (as the large neighborhood search, that does not use the moves)
+    unique_ptr<Sched_ParallelTempering> Sched_pt;
+    unique_ptr<Sched_IslandModel> Sched_im;
+    unique_ptr<Sched_LargeNeighborhoodSearch> Sched_lns;
+    function<SolverResult<Sched_Input, Sched_Output>(const Sched_Output&)> solve = [&](const Sched_Output& init) { return Sched_solver.Resolve(init); };
+    if (method == "PT")
+    {
+      Sched_pt = make_unique<Sched_ParallelTempering>(in, Sched_sm, Union_nhe, pool,
+                                                     pt_replicas.IsSet() ? (unsigned)pt_replicas : 8,
+                                                     pt_max_temperature.IsSet() ? (double)pt_max_temperature : 20.0,
+                                                     pt_min_temperature.IsSet() ? (double)pt_min_temperature : 0.5,
+                                                     pt_exchange_interval.IsSet() ? (unsigned long)pt_exchange_interval : 1000,
+                                                     pt_max_evaluations.IsSet() ? (unsigned long)pt_max_evaluations : 1000000);
+      solve = [&](const Sched_Output& init) { return Sched_pt->Resolve(init); };
+    }
+    else if (method == "IM")
+    {
+      Sched_im = make_unique<Sched_IslandModel>(in, Sched_sm, Union_nhe,
+                                               im_islands.IsSet() ? (unsigned)im_islands : 4,
+                                               im_max_temperature.IsSet() ? (double)im_max_temperature : 20.0,
+                                               im_min_temperature.IsSet() ? (double)im_min_temperature : 0.5,
+                                               im_migration_interval.IsSet() ? (unsigned long)im_migration_interval : 10000,
+                                               im_max_evaluations.IsSet() ? (unsigned long)im_max_evaluations : 1000000);
+      solve = [&](const Sched_Output& init) { return Sched_im->Resolve(init); };
+    }
+    else if (method == "LNS")
+    {
+      Sched_lns = make_unique<Sched_LargeNeighborhoodSearch>(in, Sched_sm,
+                                                            lns_destroy_fraction.IsSet() ? (double)lns_destroy_fraction : 0.3,
+                                                            lns_max_time.IsSet() ? (double)lns_max_time : 60.0,
+                                                            lns_max_iterations.IsSet() ? (unsigned long)lns_max_iterations : 1000000);
+      solve = [&](const Sched_Output& init) { return Sched_lns->Resolve(init); };
+    }
+
+    // The trajectory follows the moves of a single chain
+    unique_ptr<Sched_TrajectoryLogger> trajectory_logger;
+    unique_ptr<Sched_TrajectoryRecorder> trajectory_recorder;
+    if (trajectory_file.IsSet())
+    {
+      if (method == "PT" || method == "IM" || method == "LNS" || (restarts.IsSet() && restarts > 1))
+      {
+        cerr << "The trajectory is logged only for a single HC, SD, SA or TS run" << endl;
+        return 1;
+      }
+      if (trajectory_format.IsSet() && trajectory_format != "CSV" && trajectory_format != "Binary")
+      {
+        cerr << "Unknown trajectory format " << static_cast<string>(trajectory_format) << endl;
+        return 1;
+      }
+      trajectory_logger = make_unique<Sched_TrajectoryLogger>(static_cast<string>(trajectory_file), trajectory_format.IsSet() && trajectory_format == "Binary");
+      trajectory_recorder = make_unique<Sched_TrajectoryRecorder>(Sched_sm, *trajectory_logger, trajectory_sample.IsSet() ? (unsigned long)trajectory_sample : 10000);
+      Union_nhe.AddObserver(trajectory_recorder.get());
+    }
+
+    // So are the run statistics: the concurrent chains of PT and IM would add up their deltas in one cost, and the
+    // restarts run in child processes whose explorers are not seen here
+    if (statistics.IsSet() && statistics && (method == "PT" || method == "IM" || method == "LNS" || (restarts.IsSet() && restarts > 1)))
+    {
+      cerr << "The run statistics are kept only for a single HC, SD, SA or TS run" << endl;
+      return 1;
+    }
+
+    // A checkpoint holds the state of a single run (for the EasyLocal runners their counters, temperature and tabu
+    // list as well), so that a resumed run goes on as the interrupted one would have; only the adaptive weights of
+    // the neighborhoods start afresh
+    unique_ptr<Sched_Checkpointer> checkpointer;
+    Sched_Checkpointer::Checkpoint resumed;
+    bool resuming = false;
+    if (checkpoint_file.IsSet())
+    {
+      if (method == "IM" || method == "LNS" || (restarts.IsSet() && restarts > 1))
+      {
+        cerr << "Checkpoints are saved only for a single HC, SD, SA, TS or PT run" << endl;
+        return 1;
+      }
+      resuming = resume.IsSet() && resume && filesystem::exists(static_cast<string>(checkpoint_file));
+      if (resuming)
+      {
+        try
+        {
+          resumed = Sched_Checkpointer::Read(static_cast<string>(checkpoint_file), in);
+        }
+        catch (const runtime_error& e)
+        {
+          cerr << e.what() << endl;
+          return 1;
+        }
+        if (resumed.runner != static_cast<string>(method))
+        {
+          cerr << "The checkpoint belongs to a " << resumed.runner << " run" << endl;
+          return 1;
+        }
+        if (Sched_pt ? resumed.generators.empty() : !runner_checkpoints->ValidCheckpoint(resumed))
+        {
+          cerr << "Corrupted checkpoint " << static_cast<string>(checkpoint_file) << endl;
+          return 1;
+        }
+        // The EasyLocal runners restore Random themselves, after their initialization
+        if (Sched_pt)
+          istringstream(resumed.generators[0]) >> Random::GetGenerator();
+      }
+      checkpointer = make_unique<Sched_Checkpointer>(static_cast<string>(checkpoint_file), checkpoint_interval.IsSet() ? (double)checkpoint_interval : 600.0);
+      if (Sched_pt)
+        Sched_pt->SetCheckpointer(checkpointer.get());
+      else
+        runner_checkpoints->SetCheckpointer(checkpointer.get(), resuming ? &resumed : nullptr);
+    }
+    else if (resume.IsSet() && resume)
+    {
+      cerr << "Resume needs a checkpoint file" << endl;
+      return 1;
+    }
+
+    if (restarts.IsSet() && restarts > 1)
+      return MultiStartSolve(solve, Sched_sm, in, restarts, threads.IsSet() && threads > 0 ? (unsigned)threads : 1,
+                             seed.IsSet() ? (int)seed : (int)(random_device()() >> 1),
+                             init_method.IsSet() ? (string)init_method : "Random", init_state.IsSet() ? (string)init_state : "",
+                             output_file.IsSet() ? (string)output_file : "");
+
+    // A single run starts from the initial state file, if given
+    Sched_Output init(in);
+    if (init_state.IsSet() && !ReadState(static_cast<string>(init_state), init))
+      return 1;
+
+    Sched_RunStatistics run_statistics;
+    if (statistics.IsSet() && statistics)
+      Union_nhe.AddObserver(&run_statistics);
+
+    SolverResult<Sched_Input, Sched_Output> result = resuming ? (Sched_pt ? Sched_pt->Resume(resumed) : solve(resumed.states[0]))
+                                                     : init_state.IsSet() ? solve(init)
+                                                     : Sched_pt ? Sched_pt->Solve() : Sched_im ? Sched_im->Solve() : Sched_lns ? Sched_lns->Solve() : Sched_solver.Solve();
+    if (resuming && !Sched_pt) // the solver times only the part after the checkpoint
+      result.running_time += resumed.elapsed;
+    if (checkpointer)
+    { // the run is over, its checkpoint is not needed any more
+      checkpointer->Close();
+      remove(static_cast<string>(checkpoint_file).c_str());
+    }
     Sched_Output out = result.output;
+    if (trajectory_logger)
+    {
+      trajectory_logger->Log(Sched_TrajectoryLogger::END, trajectory_recorder->Moves(), result.cost.total, result.cost.violations, result.cost.all_components);
+      trajectory_logger->Close();
+      if (trajectory_logger->Dropped() > 0)
+        cerr << "Trajectory: " << trajectory_logger->Dropped() << " events dropped (buffer full)" << endl;
+    }
+    if (save_snapshot.IsSet())
+    {
+      ofstream os(static_cast<string>(save_snapshot), ios::binary);
+      out.WriteSnapshot(os);
+    }
     if (output_file.IsSet())
     { // write the output on the file passed in the command line
       ofstream os(static_cast<string>(output_file));
@@ -165,6 +544,14 @@ int main(int argc, const char* argv[])
          << "ProfMaxWeeklyHours:\t" << result.cost.all_components[2] << endl
          << "ScheduleContiguity:\t" << result.cost.all_components[3] << endl;
       os << "Time:\t" << result.running_time << "\ts " << endl;
+      if (statistics.IsSet() && statistics)
+        os << "Moves:\t" << run_statistics.MadeMoves() << endl
+           << "DeltaEvaluations:\t" << run_statistics.DeltaEvaluations() << endl
+           << "TimeToBest:\t" << run_statistics.TimeToBest() << "\ts" << endl;
+      if (Union_nhe.AdaptiveSelection())
+        Union_nhe.PrintOperatorStatistics(os);
+      if (Sched_Profiler::Enabled())
+        Sched_Profiler::PrintReport(os);
       os.close();
     }
     else
@@ -177,6 +564,24 @@ int main(int argc, const char* argv[])
            << "ProfMaxWeeklyHours:\t" << result.cost.all_components[2] << endl
            << "ScheduleContiguity:\t" << result.cost.all_components[3] << endl;
       cout << "Time:\t" << result.running_time << "\ts" << endl;				
+      if (statistics.IsSet() && statistics)
+        cout << "Moves:\t" << run_statistics.MadeMoves() << endl
+             << "DeltaEvaluations:\t" << run_statistics.DeltaEvaluations() << endl
+             << "TimeToBest:\t" << run_statistics.TimeToBest() << "\ts" << endl;
+      if (Union_nhe.AdaptiveSelection())
+        Union_nhe.PrintOperatorStatistics(cout);
+      if (Sched_Profiler::Enabled())
+        Sched_Profiler::PrintReport(cout);
+    }
+    if (profile_file.IsSet())
+    {
+      if (!Sched_Profiler::Enabled())
+        cerr << "Profiling is not compiled in (make PROFILE=1), " << static_cast<string>(profile_file) << " not written" << endl;
+      else
+      {
+        ofstream os(static_cast<string>(profile_file));
+        Sched_Profiler::WriteJSON(os);
+      }
     }
   }
 
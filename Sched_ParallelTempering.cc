@@ -0,0 +1,205 @@
+// File Sched_ParallelTempering.cc
+#include "Sched_Headers.hh"
+#include <cmath>
+#include <chrono>
+#include <sstream>
+
+/***************************************************************************
+ * Parallel Tempering Code
+ ***************************************************************************/
+
+Sched_ParallelTempering::Sched_ParallelTempering(const Sched_Input& pin, Sched_SolutionManager& psm, NeighborhoodExplorer<Sched_Input, Sched_Output, Sched_UnionMove>& pnhe, Sched_ThreadPool& ppool,
+                                                 unsigned n_replicas, double max_temperature, double min_temperature, unsigned long interval, unsigned long evaluations)
+  : in(pin), sm(psm), nhe(pnhe), pool(ppool), replicas(n_replicas), exchange_interval(interval), max_evaluations(evaluations), temperatures(n_replicas),
+    accepted_exchanges(0), attempted_exchanges(0), checkpointer(nullptr)
+{
+  unsigned t;
+
+  if (replicas == 0 || exchange_interval == 0)
+    throw runtime_error("Parallel tempering needs at least one replica and a positive exchange interval");
+  if (min_temperature <= 0 || max_temperature < min_temperature)
+    throw runtime_error("Parallel tempering needs 0 < min_temperature <= max_temperature");
+
+  // Geometric ladder: temperatures[0] = max_temperature, temperatures[replicas - 1] = min_temperature
+  for (t = 0; t < replicas; t++)
+    if (replicas == 1)
+      temperatures[t] = min_temperature;
+    else
+      temperatures[t] = max_temperature * pow(min_temperature / max_temperature, double(t) / (replicas - 1));
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_ParallelTempering::Solve()
+{
+  Sched_Output init(in);
+
+  sm.RandomState(init);
+  return Resolve(init);
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_ParallelTempering::Resolve(const Sched_Output& init)
+{
+  unsigned t;
+
+  // Replica r is a state; replica_at[t] is the replica currently at temperature t
+  vector<Sched_Output> states(replicas, init), best_states(replicas, init);
+  vector<unsigned> replica_at(replicas);
+  vector<mt19937> rngs;   // one per temperature, for the moves and the Metropolis tests of its chain
+  mt19937 exchange_rng(Random::Uniform<unsigned>(0, numeric_limits<unsigned>::max()));
+
+  for (t = 0; t < replicas; t++)
+  {
+    replica_at[t] = t;
+    rngs.emplace_back(Random::Uniform<unsigned>(0, numeric_limits<unsigned>::max()));
+  }
+  accepted_exchanges = 0;
+  attempted_exchanges = 0;
+
+  return Run(states, best_states, replica_at, rngs, exchange_rng, 0, 0, 0.0);
+}
+
+SolverResult<Sched_Input, Sched_Output> Sched_ParallelTempering::Resume(const Sched_Checkpointer::Checkpoint& checkpoint)
+{
+  unsigned t;
+  vector<Sched_Output> states, best_states;
+  vector<unsigned> replica_at(replicas);
+  vector<mt19937> rngs(replicas);
+  mt19937 exchange_rng;
+  vector<bool> placed(replicas, false);
+
+  if (checkpoint.states.size() != 2 * replicas || checkpoint.counters.size() != 4 + replicas || checkpoint.generators.size() != replicas + 2)
+    throw runtime_error("The checkpoint does not match the number of replicas");
+
+  states.assign(checkpoint.states.begin(), checkpoint.states.begin() + replicas);
+  best_states.assign(checkpoint.states.begin() + replicas, checkpoint.states.end());
+  accepted_exchanges = checkpoint.counters[2];
+  attempted_exchanges = checkpoint.counters[3];
+  for (t = 0; t < replicas; t++)
+  {
+    replica_at[t] = checkpoint.counters[4 + t];
+    if (replica_at[t] >= replicas || placed[replica_at[t]])
+      throw runtime_error("Corrupted replica positions in the checkpoint");
+    placed[replica_at[t]] = true;
+    istringstream(checkpoint.generators[1 + t]) >> rngs[t];
+  }
+  istringstream(checkpoint.generators[replicas + 1]) >> exchange_rng;
+
+  return Run(states, best_states, replica_at, rngs, exchange_rng, checkpoint.counters[0], checkpoint.counters[1], checkpoint.elapsed);
+}
+
+// Exchange rounds from the given evaluation and round on; elapsed is the running time of the rounds before
+SolverResult<Sched_Input, Sched_Output> Sched_ParallelTempering::Run(vector<Sched_Output>& states, vector<Sched_Output>& best_states, vector<unsigned>& replica_at, vector<mt19937>& rngs, mt19937& exchange_rng,
+                                                                     unsigned long evaluations, unsigned long round, double elapsed)
+{
+  unsigned t, first, r, best_t;
+  unsigned long steps;
+  double delta;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<DefaultCostStructure<int>> costs(replicas), best_costs(replicas);
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  for (r = 0; r < replicas; r++)
+  {
+    costs[r] = sm.CostFunctionComponents(states[r]);
+    best_costs[r] = sm.CostFunctionComponents(best_states[r]);
+  }
+
+  for (; evaluations < max_evaluations; evaluations += steps)
+  {
+    steps = min(exchange_interval, max_evaluations - evaluations);
+
+    pool.ParallelFor(replicas, [&](unsigned t)
+    {
+      RunChain(states[replica_at[t]], costs[replica_at[t]], best_states[replica_at[t]], best_costs[replica_at[t]], temperatures[t], rngs[t], steps);
+    });
+
+    // Exchanges between neighboring temperatures, alternating even and odd pairs
+    first = round % 2;
+    for (t = first; t + 1 < replicas; t += 2)
+    {
+      attempted_exchanges++;
+      delta = (1.0 / temperatures[t + 1] - 1.0 / temperatures[t]) * (costs[replica_at[t + 1]].total - costs[replica_at[t]].total);
+      if (delta >= 0 || uniform(exchange_rng) < exp(delta))
+      {
+        swap(replica_at[t], replica_at[t + 1]);
+        accepted_exchanges++;
+      }
+    }
+    round++;
+
+    if (checkpointer != nullptr && checkpointer->Due())
+      SubmitCheckpoint(states, best_states, replica_at, rngs, exchange_rng, evaluations + steps, round,
+                       elapsed + chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  }
+
+  best_t = 0;
+  for (r = 1; r < replicas; r++)
+    if (best_costs[r] < best_costs[best_t])
+      best_t = r;
+
+  return SolverResult<Sched_Input, Sched_Output>(best_states[best_t], best_costs[best_t],
+                                                 elapsed + chrono::duration<double>(chrono::steady_clock::now() - start).count());
+}
+
+void Sched_ParallelTempering::SubmitCheckpoint(const vector<Sched_Output>& states, const vector<Sched_Output>& best_states, const vector<unsigned>& replica_at, const vector<mt19937>& rngs, const mt19937& exchange_rng,
+                                               unsigned long evaluations, unsigned long round, double elapsed)
+{
+  Sched_Checkpointer::Checkpoint checkpoint;
+  ostringstream generator;
+  unsigned t;
+
+  checkpoint.runner = "PT";
+  checkpoint.elapsed = elapsed;
+  checkpoint.counters = {evaluations, round, accepted_exchanges, attempted_exchanges};
+  checkpoint.counters.insert(checkpoint.counters.end(), replica_at.begin(), replica_at.end());
+
+  generator << Random::GetGenerator();
+  checkpoint.generators.push_back(generator.str());
+  for (t = 0; t < replicas; t++)
+  {
+    generator.str("");
+    generator << rngs[t];
+    checkpoint.generators.push_back(generator.str());
+  }
+  generator.str("");
+  generator << exchange_rng;
+  checkpoint.generators.push_back(generator.str());
+
+  checkpoint.states = states;
+  checkpoint.states.insert(checkpoint.states.end(), best_states.begin(), best_states.end());
+  checkpointer->Submit(move(checkpoint));
+}
+
+// Metropolis chain at a fixed temperature on one replica, keeps the best state met by the replica. The moves are drawn
+// with the generator of the temperature, bound to the thread for the explorers
+void Sched_ParallelTempering::RunChain(Sched_Output& st, DefaultCostStructure<int>& cost, Sched_Output& best, DefaultCostStructure<int>& best_cost, double temperature, mt19937& rng, unsigned long steps)
+{
+  unsigned long i;
+  Sched_UnionMove mv;
+  DefaultCostStructure<int> delta;
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  Sched_Random::ChainScope scope(rng);
+
+  for (i = 0; i < steps; i++)
+  {
+    try
+    {
+      nhe.RandomMove(st, mv);
+    }
+    catch (EmptyNeighborhood&)
+    {
+      return;
+    }
+
+    delta = nhe.DeltaCostFunctionComponents(st, mv);
+    if (delta.total <= 0 || uniform(rng) < exp(-delta.total / temperature))
+    {
+      nhe.MakeMove(st, mv);
+      cost += delta;
+      if (cost < best_cost)
+      {
+        best = st;
+        best_cost = cost;
+      }
+    }
+  }
+}
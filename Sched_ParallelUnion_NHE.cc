@@ -0,0 +1,715 @@
+// File Sched_ParallelUnion_NHE.cc
+#include "Sched_Headers.hh"
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+  // Adaptive selection help struct: the last random move drawn by the thread, waiting for its delta evaluation (that
+  // closes its time) and then for MakeMove (that credits its improvement)
+  struct PendingRandomMove
+  {
+    const Sched_AdaptiveSelection* adaptive = nullptr;   // selection that drew the move
+    int neighborhood = -1;
+    bool evaluated = false;
+    int delta = 0;
+    chrono::steady_clock::time_point start;
+  };
+
+  thread_local PendingRandomMove pending_move;
+
+  const char* neighborhood_names[5] = {"SwapHours", "AssignProf", "SwapProf", "CrossSwapHours", "KempeChain"};
+
+  // Help function: index of the active move of the union (-1 if none)
+  int ActiveNeighborhood(const Sched_UnionMove& mv)
+  {
+    if (get<0>(mv).active)
+      return 0;
+    else if (get<1>(mv).active)
+      return 1;
+    else if (get<2>(mv).active)
+      return 2;
+    else if (get<3>(mv).active)
+      return 3;
+    else if (get<4>(mv).active)
+      return 4;
+    return -1;
+  }
+}
+
+/***************************************************************************
+ * Union Neighborhood Explorer with parallel SelectBest Code
+ ***************************************************************************/
+
+EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>> Sched_ParallelUnion_NeighborhoodExplorer::SelectBest(const Sched_Output& st, size_t& explored, const MoveAcceptor& AcceptMove, const vector<double>& weights) const
+{
+  EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>> best;
+
+  // The cached deltas are unweighted
+  if (incremental && weights.empty())
+  {
+    // The state has been changed out of MakeMove (e.g., a new run): every block is evaluated again
+    if (!cache_valid || st.Version() != cache_version)
+    {
+      cache_version = st.Version();
+      cached_moves[0].assign(swap_h_nhe.N_Blocks(), {});
+      cached_moves[1].assign(assign_p_nhe.N_Blocks(), {});
+      cached_moves[2].assign(swap_p_nhe.N_Blocks(), {});
+      cached_moves[3].assign(cross_h_nhe.N_Blocks(), {});
+      cached_moves[4].assign(kempe_nhe.N_Blocks(), {});
+      stale_blocks[0].assign(swap_h_nhe.N_Blocks(), true);
+      stale_blocks[1].assign(assign_p_nhe.N_Blocks(), true);
+      stale_blocks[2].assign(swap_p_nhe.N_Blocks(), true);
+      stale_blocks[3].assign(cross_h_nhe.N_Blocks(), true);
+      stale_blocks[4].assign(kempe_nhe.N_Blocks(), true);
+      cache_valid = true;
+    }
+
+    explored = 0;
+    evaluated_moves = 0;
+
+    SelectBestInCachedNeighborhood<0>(swap_h_nhe, st, best, explored, AcceptMove);
+    SelectBestInCachedNeighborhood<1>(assign_p_nhe, st, best, explored, AcceptMove);
+    SelectBestInCachedNeighborhood<2>(swap_p_nhe, st, best, explored, AcceptMove);
+    SelectBestInCachedNeighborhood<3>(cross_h_nhe, st, best, explored, AcceptMove);
+    SelectBestInCachedNeighborhood<4>(kempe_nhe, st, best, explored, AcceptMove);
+
+    RecordSelectBest(best, evaluated_moves);
+    return best;
+  }
+
+  // The evaluations are counted by DeltaCostFunctionComponents
+  if (pool.N_Threads() == 1 && AllNeighborhoodsEnabled())
+  {
+    best = UnionNHE::SelectBest(st, explored, AcceptMove, weights);
+    RecordSelectBest(best, 0);
+    return best;
+  }
+
+  explored = 0;
+
+  SelectBestInNeighborhood<0>(swap_h_nhe, st, best, explored, AcceptMove, weights);
+  SelectBestInNeighborhood<1>(assign_p_nhe, st, best, explored, AcceptMove, weights);
+  SelectBestInNeighborhood<2>(swap_p_nhe, st, best, explored, AcceptMove, weights);
+  SelectBestInNeighborhood<3>(cross_h_nhe, st, best, explored, AcceptMove, weights);
+  SelectBestInNeighborhood<4>(kempe_nhe, st, best, explored, AcceptMove, weights);
+
+  RecordSelectBest(best, explored);
+  return best;
+}
+
+// Evaluates the moves of the i-th neighborhood of the union, one block per job, and updates the best move
+template <size_t i, class NHE>
+void Sched_ParallelUnion_NeighborhoodExplorer::SelectBestInNeighborhood(const NHE& nhe, const Sched_Output& st, EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t& explored, const MoveAcceptor& AcceptMove, const vector<double>& weights) const
+{
+  unsigned b;
+  vector<EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>> block_best(nhe.N_Blocks());
+  vector<size_t> block_explored(nhe.N_Blocks(), 0);
+
+  if (!enabled[i])
+    return;
+
+  pool.ParallelFor(nhe.N_Blocks(), [&](unsigned b)
+  {
+    Sched_UnionMove mv;
+    DefaultCostStructure<int> cost;
+
+    // Only the move of the i-th neighborhood is active
+    get<0>(mv).active = false;
+    get<1>(mv).active = false;
+    get<2>(mv).active = false;
+    get<3>(mv).active = false;
+    get<4>(mv).active = false;
+    get<i>(mv).active = true;
+
+    if (!nhe.FirstMoveInBlock(st, get<i>(mv), b))
+      return;
+
+    do
+    {
+      cost = nhe.DeltaCostFunctionComponents(st, get<i>(mv), weights);
+      block_explored[b]++;
+
+      if (AcceptMove(mv, cost) && (!block_best[b].is_valid || cost < block_best[b].cost))
+        block_best[b] = EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>(mv, cost);
+    } while (nhe.NextMoveInBlock(st, get<i>(mv)));
+  });
+
+  // Deterministic reduction: on ties the move of the lowest block (and of the first neighborhood) wins
+  for (b = 0; b < nhe.N_Blocks(); b++)
+  {
+    explored += block_explored[b];
+
+    if (block_best[b].is_valid && (!best.is_valid || block_best[b].cost < best.cost))
+      best = block_best[b];
+  }
+}
+
+// Like SelectBestInNeighborhood, but the moves of the blocks that are not stale come from the cache
+// (explored counts all the moves of the neighborhood, evaluated or not)
+template <size_t i, class NHE>
+void Sched_ParallelUnion_NeighborhoodExplorer::SelectBestInCachedNeighborhood(const NHE& nhe, const Sched_Output& st, EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t& explored, const MoveAcceptor& AcceptMove) const
+{
+  unsigned b;
+  vector<EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>> block_best(nhe.N_Blocks());
+  vector<size_t> block_evaluated(nhe.N_Blocks(), 0);
+
+  if (!enabled[i])
+    return;
+
+  pool.ParallelFor(nhe.N_Blocks(), [&](unsigned b)
+  {
+    Sched_UnionMove mv;
+    vector<EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>>& moves = cached_moves[i][b];
+
+    if (stale_blocks[i][b])
+    {
+      // Only the move of the i-th neighborhood is active
+      get<0>(mv).active = false;
+      get<1>(mv).active = false;
+      get<2>(mv).active = false;
+      get<3>(mv).active = false;
+      get<4>(mv).active = false;
+      get<i>(mv).active = true;
+
+      moves.clear();
+      if (nhe.FirstMoveInBlock(st, get<i>(mv), b))
+        do
+          moves.emplace_back(mv, nhe.DeltaCostFunctionComponents(st, get<i>(mv)));
+        while (nhe.NextMoveInBlock(st, get<i>(mv)));
+
+      block_evaluated[b] = moves.size();
+      stale_blocks[i][b] = false;
+    }
+
+    for (const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& em : moves)
+      if (AcceptMove(em.move, em.cost) && (!block_best[b].is_valid || em.cost < block_best[b].cost))
+        block_best[b] = em;
+  });
+
+  // Deterministic reduction, as in SelectBestInNeighborhood
+  for (b = 0; b < nhe.N_Blocks(); b++)
+  {
+    explored += cached_moves[i][b].size();
+    evaluated_moves += block_evaluated[b];
+
+    if (block_best[b].is_valid && (!best.is_valid || block_best[b].cost < best.cost))
+      best = block_best[b];
+  }
+}
+
+void Sched_ParallelUnion_NeighborhoodExplorer::MakeMove(Sched_Output& st, const Sched_UnionMove& mv) const
+{
+  for (Sched_MoveObserver* observer : observers)
+    observer->MoveMade(st, mv);
+
+  // Without a cache for st (or for concurrent chains, e.g. parallel tempering) this is the plain union move
+  if (!incremental || !cache_valid || st.Version() != cache_version)
+  {
+    cache_valid = false;
+    UnionNHE::MakeMove(st, mv);
+  }
+  else
+    MakeCachedMove(st, mv);
+}
+
+// Makes the move on the cached state, and marks the cached blocks that the move affects
+void Sched_ParallelUnion_NeighborhoodExplorer::MakeCachedMove(Sched_Output& st, const Sched_UnionMove& mv) const
+{
+  vector<unsigned> classes, profs, days;
+  unsigned i;
+  int p;
+  uint64_t hours;
+
+  // Classes and professors whose data change with the move (read before making it)
+  if (get<0>(mv).active)
+  {
+    const Sched_SwapHours& m = get<0>(mv);
+    classes.push_back(m._class);
+    if ((p = st.Class_Schedule(m._class, m.day_1, m.hour_1)) != -1)
+      profs.push_back(p);
+    if ((p = st.Class_Schedule(m._class, m.day_2, m.hour_2)) != -1)
+      profs.push_back(p);
+    days.push_back(m.day_1);
+    days.push_back(m.day_2);
+  }
+  else if (get<1>(mv).active)
+  {
+    const Sched_AssignProf& m = get<1>(mv);
+    classes.push_back(m._class);
+    profs.push_back(m.prof);
+    days.push_back(m.day);
+  }
+  else if (get<2>(mv).active)
+  {
+    const Sched_SwapProf& m = get<2>(mv);
+    classes.push_back(m.class_1);
+    classes.push_back(m.class_2);
+    profs.push_back(st.Subject_Prof(m.class_1, m.subject));
+    profs.push_back(st.Subject_Prof(m.class_2, m.subject));
+    hours = st.ClassSubjectMask(m.class_1, m.subject) | st.ClassSubjectMask(m.class_2, m.subject);
+    for (i = 0; i < in.N_Days(); i++)
+      if (((hours >> (i * in.N_HoursXDay())) & st.DayMask()) != 0)
+        days.push_back(i);
+  }
+  else if (get<3>(mv).active)
+  {
+    const Sched_CrossSwapHours& m = get<3>(mv);
+    classes.push_back(m.class_1);
+    classes.push_back(m.class_2);
+    profs.push_back(st.Class_Schedule(m.class_1, m.day_1, m.hour_1));
+    if ((p = st.Class_Schedule(m.class_1, m.day_2, m.hour_2)) != -1)
+      profs.push_back(p);
+    if ((p = st.Class_Schedule(m.class_2, m.day_1, m.hour_1)) != -1)
+      profs.push_back(p);
+    days.push_back(m.day_1);
+    days.push_back(m.day_2);
+  }
+  else if (get<4>(mv).active)
+  {
+    const Sched_KempeChain& m = get<4>(mv);
+    st.KempeChain(m._class, m.day_1, m.hour_1, m.day_2, m.hour_2, classes);
+    for (i = 0; i < classes.size(); i++)
+    {
+      if ((p = st.Class_Schedule(classes[i], m.day_1, m.hour_1)) != -1)
+        profs.push_back(p);
+      if ((p = st.Class_Schedule(classes[i], m.day_2, m.hour_2)) != -1)
+        profs.push_back(p);
+    }
+    days.push_back(m.day_1);
+    days.push_back(m.day_2);
+  }
+
+  UnionNHE::MakeMove(st, mv);
+  cache_version = st.Version();
+  MarkStaleBlocks(st, classes, profs, days);
+}
+
+// Marks the blocks whose moves read data of the given classes, professors or days, using the state after the move
+// (for the other classes the relations with the professors have not changed)
+void Sched_ParallelUnion_NeighborhoodExplorer::MarkStaleBlocks(const Sched_Output& st, const vector<unsigned>& classes, const vector<unsigned>& profs, const vector<unsigned>& days) const
+{
+  unsigned i, j, c, s, d;
+  int p;
+  vector<bool> touched_classes(in.N_Classes(), false), shared_profs(in.N_Profs(), false);
+
+  for (i = 0; i < classes.size(); i++)
+  {
+    stale_blocks[0][classes[i]] = true;
+    stale_blocks[1][classes[i]] = true;
+    touched_classes[classes[i]] = true;
+  }
+
+  for (j = 0; j < profs.size(); j++)
+  {
+    s = in.ProfSubject(profs[j]);
+
+    // SwapProf moves of a subject read the professors of that subject (and the hours of the subject, that
+    // change only together with them)
+    stale_blocks[2][s] = true;
+
+    for (c = 0; c < in.N_Classes(); c++)
+    {
+      // SwapHours moves of a class read the professors teaching in it
+      if (st.Subject_Prof(c, s) == (int)profs[j])
+      {
+        stale_blocks[0][c] = true;
+        touched_classes[c] = true;
+      }
+
+      // AssignProf moves of a class read its candidate professors
+      if (((st.ClassOpenSubjects(c) >> s) & 1) && (st.Subject_Prof(c, s) == (int)profs[j] || st.Subject_Prof(c, s) == -1))
+        stale_blocks[1][c] = true;
+    }
+  }
+
+  // CrossSwapHours moves of a class read the hours of the classes it shares a professor with (and of their
+  // professors): the blocks of the classes sharing a professor with a touched class are stale
+  for (c = 0; c < in.N_Classes(); c++)
+    if (touched_classes[c])
+      for (s = 0; s < in.N_Subjects(); s++)
+        if ((p = st.Subject_Prof(c, s)) != -1)
+          shared_profs[p] = true;
+
+  for (c = 0; c < in.N_Classes(); c++)
+  {
+    stale_blocks[3][c] = stale_blocks[3][c] || touched_classes[c];
+    for (s = 0; s < in.N_Subjects() && !stale_blocks[3][c]; s++)
+      if ((p = st.Subject_Prof(c, s)) != -1 && shared_profs[p])
+        stale_blocks[3][c] = true;
+  }
+
+  // KempeChain moves of a pair of days read only the hours of those days (of any class and professor)
+  for (i = 0; i < days.size(); i++)
+    for (d = 0; d < in.N_Days(); d++)
+      stale_blocks[4][kempe_nhe.Block(min(d, days[i]), max(d, days[i]))] = true;
+}
+
+// The selected move is the one the runner makes next
+void Sched_ParallelUnion_NeighborhoodExplorer::RecordSelectBest(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations) const
+{
+  for (Sched_MoveObserver* observer : observers)
+    observer->BestSelected(best, evaluations);
+}
+
+/***************************************************************************
+ * Adaptive selection of the neighborhood of the random moves
+ ***************************************************************************/
+
+void Sched_ParallelUnion_NeighborhoodExplorer::SetAdaptiveSelection(Sched_AdaptiveSelection* padaptive)
+{
+  if (adaptive != nullptr)
+    RemoveObserver(adaptive);
+  adaptive = padaptive;
+  if (adaptive != nullptr)
+    AddObserver(adaptive);
+}
+
+void Sched_ParallelUnion_NeighborhoodExplorer::RandomMove(const Sched_Output& st, Sched_UnionMove& mv) const
+{
+  unsigned i;
+  bool found;
+
+  // A single chain on all the neighborhoods draws through EasyLocal, the concurrent chains with their own generators
+  if (adaptive == nullptr && !Sched_Random::ChainBound() && AllNeighborhoodsEnabled())
+  {
+    UnionNHE::RandomMove(st, mv);
+    return;
+  }
+
+  bool excluded[5] = {!enabled[0], !enabled[1], !enabled[2], !enabled[3], !enabled[4]};
+
+  // Draws the neighborhoods (by weight if adaptive) until one is not empty; the time of the empty ones is charged to them
+  if (adaptive != nullptr)
+    adaptive->DrawStarted();
+  do
+  {
+    i = DrawNeighborhood(excluded);
+    switch (i)
+    {
+      case 0: found = RandomMoveInNeighborhood<0>(swap_h_nhe, st, mv); break;
+      case 1: found = RandomMoveInNeighborhood<1>(assign_p_nhe, st, mv); break;
+      case 2: found = RandomMoveInNeighborhood<2>(swap_p_nhe, st, mv); break;
+      case 3: found = RandomMoveInNeighborhood<3>(cross_h_nhe, st, mv); break;
+      default: found = RandomMoveInNeighborhood<4>(kempe_nhe, st, mv); break;
+    }
+
+    if (!found)
+    {
+      if (adaptive != nullptr)
+        adaptive->NeighborhoodEmpty(i);
+      excluded[i] = true;
+    }
+  } while (!found && count(excluded, excluded + 5, false) > 0);
+
+  if (!found)
+  {
+    if (adaptive != nullptr)
+      adaptive->DrawFailed();
+    throw EmptyNeighborhood();
+  }
+  if (adaptive != nullptr)
+    adaptive->NeighborhoodDrawn(i);
+}
+
+DefaultCostStructure<int> Sched_ParallelUnion_NeighborhoodExplorer::DeltaCostFunctionComponents(const Sched_Output& st, const Sched_UnionMove& mv, const vector<double>& weights) const
+{
+  DefaultCostStructure<int> delta = UnionNHE::DeltaCostFunctionComponents(st, mv, weights);
+
+  for (Sched_MoveObserver* observer : observers)
+    observer->MoveEvaluated(mv, delta);
+  return delta;
+}
+
+// Draws a random move of the i-th neighborhood, with only that move active; false if the neighborhood is empty
+template <size_t i, class NHE>
+bool Sched_ParallelUnion_NeighborhoodExplorer::RandomMoveInNeighborhood(const NHE& nhe, const Sched_Output& st, Sched_UnionMove& mv) const
+{
+  get<0>(mv).active = false;
+  get<1>(mv).active = false;
+  get<2>(mv).active = false;
+  get<3>(mv).active = false;
+  get<4>(mv).active = false;
+
+  try
+  {
+    nhe.RandomMove(st, get<i>(mv));
+  }
+  catch (EmptyNeighborhood&)
+  {
+    return false;
+  }
+
+  get<i>(mv).active = true;
+  return true;
+}
+
+// Roulette wheel on the weights of the neighborhoods not excluded (all equal without adaptive selection), each weight is
+// at least 2% of the largest one so that no neighborhood is starved for good
+unsigned Sched_ParallelUnion_NeighborhoodExplorer::DrawNeighborhood(const bool excluded[5]) const
+{
+  double weights[5], max_weight = 0, total = 0, r;
+  unsigned i, last = 0;
+
+  for (i = 0; i < 5; i++)
+  {
+    weights[i] = adaptive != nullptr ? adaptive->Weight(i) : 1.0;
+    max_weight = max(max_weight, weights[i]);
+  }
+
+  for (i = 0; i < 5; i++)
+    if (!excluded[i])
+    {
+      weights[i] = max(weights[i], 0.02 * max_weight);
+      total += weights[i];
+      last = i;
+    }
+
+  r = Sched_Random::Uniform<double>(0.0, total);
+  for (i = 0; i < 5; i++)
+    if (!excluded[i])
+    {
+      if (r < weights[i])
+        return i;
+      r -= weights[i];
+    }
+
+  return last;
+}
+
+/***************************************************************************
+ * Adaptive Selection Code
+ ***************************************************************************/
+
+Sched_AdaptiveSelection::Sched_AdaptiveSelection(unsigned long length, double rate)
+  : segment_length(length), reaction(rate), segment_selections(0)
+{
+  unsigned i;
+
+  if (length == 0 || rate <= 0 || rate > 1)
+    throw runtime_error("Adaptive selection needs a positive segment length and 0 < reaction <= 1");
+
+  for (i = 0; i < 5; i++)
+  {
+    operator_stats[i].selections = 0;
+    operator_stats[i].empty = 0;
+    operator_stats[i].accepted = 0;
+    operator_stats[i].improving = 0;
+    operator_stats[i].improvement = 0;
+    operator_stats[i].time_ns = 0;
+    operator_stats[i].segment_improvement = 0;
+    operator_stats[i].segment_time_ns = 0;
+    operator_stats[i].weight = 1.0;
+  }
+}
+
+void Sched_AdaptiveSelection::DrawStarted()
+{
+  pending_move.adaptive = this;
+  pending_move.evaluated = false;
+  pending_move.start = chrono::steady_clock::now();
+}
+
+void Sched_AdaptiveSelection::NeighborhoodEmpty(unsigned i)
+{
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  unsigned long time_ns = chrono::duration_cast<chrono::nanoseconds>(now - pending_move.start).count();
+
+  operator_stats[i].selections++;
+  operator_stats[i].empty++;
+  operator_stats[i].time_ns += time_ns;
+  operator_stats[i].segment_time_ns += time_ns;
+  pending_move.start = now;
+  if (++segment_selections % segment_length == 0)
+    UpdateWeights();
+}
+
+void Sched_AdaptiveSelection::NeighborhoodDrawn(unsigned i)
+{
+  pending_move.neighborhood = i;
+}
+
+void Sched_AdaptiveSelection::DrawFailed()
+{
+  pending_move.adaptive = nullptr;
+}
+
+// Only the first evaluation of the move drawn by RandomMove counts (SelectBest evaluates moves as well)
+void Sched_AdaptiveSelection::MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta)
+{
+  unsigned long time_ns;
+
+  if (pending_move.adaptive != this || pending_move.evaluated)
+    return;
+
+  OperatorStatistics& stats = operator_stats[pending_move.neighborhood];
+  time_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - pending_move.start).count();
+  pending_move.evaluated = true;
+  pending_move.delta = delta.total;
+  stats.selections++;
+  stats.time_ns += time_ns;
+  stats.segment_time_ns += time_ns;
+  if (++segment_selections % segment_length == 0)
+    UpdateWeights();
+}
+
+// The random move drawn and evaluated by this thread has been accepted
+void Sched_AdaptiveSelection::MoveMade(const Sched_Output& st, const Sched_UnionMove& mv)
+{
+  if (pending_move.adaptive != this || !pending_move.evaluated)
+    return;
+
+  OperatorStatistics& stats = operator_stats[pending_move.neighborhood];
+  if (ActiveNeighborhood(mv) == pending_move.neighborhood)
+  {
+    stats.accepted++;
+    if (pending_move.delta < 0)
+    {
+      stats.improving++;
+      stats.improvement -= pending_move.delta;
+      stats.segment_improvement -= pending_move.delta;
+    }
+  }
+  pending_move.adaptive = nullptr;
+}
+
+// ALNS-style update at the end of a segment: the score of a neighborhood is its improvement per microsecond in the
+// segment, relative to the best score, and moves the weight by the reaction factor. Neighborhoods not drawn in the
+// segment keep their weight, and so do all of them if no move improved the cost.
+void Sched_AdaptiveSelection::UpdateWeights()
+{
+  lock_guard<mutex> lock(weights_mutex);
+  double scores[5], best_score = 0;
+  unsigned long time_ns[5];
+  long improvement;
+  unsigned i;
+
+  for (i = 0; i < 5; i++)
+  {
+    improvement = operator_stats[i].segment_improvement.exchange(0);
+    time_ns[i] = operator_stats[i].segment_time_ns.exchange(0);
+    scores[i] = time_ns[i] > 0 ? improvement / (time_ns[i] / 1000.0) : 0.0;
+    best_score = max(best_score, scores[i]);
+  }
+
+  if (best_score == 0)
+    return;
+
+  for (i = 0; i < 5; i++)
+    if (time_ns[i] > 0)
+      operator_stats[i].weight = (1 - reaction) * operator_stats[i].weight + reaction * scores[i] / best_score;
+}
+
+void Sched_AdaptiveSelection::PrintStatistics(ostream& os, const bool enabled[5]) const
+{
+  unsigned i;
+  double time_us;
+
+  os << "Neighborhood\tSelections\tEmpty\tAccepted\tImproving\tImprovement\tTime (ms)\tImprovement/us\tWeight" << endl;
+  for (i = 0; i < 5; i++)
+  {
+    if (!enabled[i])
+      continue;
+    time_us = operator_stats[i].time_ns / 1000.0;
+    os << neighborhood_names[i] << "\t" << operator_stats[i].selections << "\t" << operator_stats[i].empty << "\t"
+       << operator_stats[i].accepted << "\t" << operator_stats[i].improving << "\t" << operator_stats[i].improvement << "\t"
+       << time_us / 1000.0 << "\t" << (time_us > 0 ? operator_stats[i].improvement / time_us : 0.0) << "\t" << operator_stats[i].weight << endl;
+  }
+}
+
+/***************************************************************************
+ * Run Statistics Code
+ ***************************************************************************/
+
+Sched_RunStatistics::Sched_RunStatistics()
+  : run_start(chrono::steady_clock::now()), made_moves(0), delta_evaluations(0), current_delta(0), best_delta(0), time_to_best(0.0), last_valid(false), last_delta(0)
+{}
+
+void Sched_RunStatistics::MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta)
+{
+  delta_evaluations++;
+  last_valid = true;
+  last_delta = delta.total;
+}
+
+void Sched_RunStatistics::BestSelected(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations)
+{
+  delta_evaluations += evaluations;
+  last_valid = best.is_valid;
+  last_delta = best.cost.total;
+}
+
+void Sched_RunStatistics::MoveMade(const Sched_Output& st, const Sched_UnionMove& mv)
+{
+  made_moves++;
+  if (!last_valid)
+    return;
+
+  current_delta += last_delta;
+  if (current_delta < best_delta)
+  {
+    best_delta = current_delta;
+    time_to_best = chrono::duration<double>(chrono::steady_clock::now() - run_start).count();
+  }
+  last_valid = false;
+}
+
+/***************************************************************************
+ * Trajectory Recorder Code
+ ***************************************************************************/
+
+Sched_TrajectoryRecorder::Sched_TrajectoryRecorder(SolutionManager<Sched_Input, Sched_Output>& psm, Sched_TrajectoryLogger& plogger, unsigned long psample_interval)
+  : sm(psm), logger(plogger), sample_interval(max(1ul, psample_interval)), started(false), resync(false), moves(0), last_valid(false)
+{}
+
+void Sched_TrajectoryRecorder::MoveEvaluated(const Sched_UnionMove& mv, const DefaultCostStructure<int>& delta)
+{
+  last_valid = true;
+  last_delta = delta;
+}
+
+void Sched_TrajectoryRecorder::BestSelected(const EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>& best, size_t evaluations)
+{
+  last_valid = best.is_valid;
+  last_delta = best.cost;
+}
+
+// st is the state before the move: the first move logs its cost as the start, and a move whose cost was not known
+// is recorded now, from the full cost of st
+void Sched_TrajectoryRecorder::MoveMade(const Sched_Output& st, const Sched_UnionMove& mv)
+{
+  if (!started)
+  {
+    cost = sm.CostFunctionComponents(st);
+    best = cost;
+    started = true;
+    logger.Log(Sched_TrajectoryLogger::START, 0, cost.total, cost.violations, cost.all_components);
+  }
+  else if (resync)
+  {
+    cost = sm.CostFunctionComponents(st);
+    resync = false;
+    Record();
+  }
+
+  moves++;
+  if (last_valid)
+  {
+    cost += last_delta;
+    Record();
+  }
+  else
+    resync = true;
+  last_valid = false;
+}
+
+void Sched_TrajectoryRecorder::Record()
+{
+  if (cost.total < best.total)
+  {
+    best = cost;
+    logger.Log(Sched_TrajectoryLogger::IMPROVEMENT, moves, cost.total, cost.violations, cost.all_components);
+  }
+  else if (moves % sample_interval == 0)
+    logger.Log(Sched_TrajectoryLogger::SAMPLE, moves, cost.total, cost.violations, cost.all_components);
+}
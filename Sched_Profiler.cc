@@ -0,0 +1,158 @@
+// File Sched_Profiler.cc
+#include "Sched_Profiler.hh"
+#include <mutex>
+#include <iomanip>
+
+thread_local uint64_t* Sched_ProfileScope::current_child_ns = nullptr;
+
+namespace
+{
+  const char* explorer_names[Sched_Profiler::N_EXPLORERS] = {"SwapHours", "AssignProf", "SwapProf", "CrossSwapHours", "KempeChain", "CostFunction"};
+  const char* operation_names[Sched_Profiler::N_OPERATIONS] = {"RandomMove", "FeasibleMove", "MakeMove", "FirstMove", "NextMove", "FirstMoveInBlock", "NextMoveInBlock", "FusedDeltas",
+                                                               "ProfUnavailability", "MaxSubjectHoursXDay", "ProfMaxWeeklyHours", "ScheduleContiguity", "SolutionComplete"};
+
+  const unsigned n_sections = (unsigned)Sched_Profiler::N_EXPLORERS * Sched_Profiler::N_OPERATIONS;
+
+  // Help struct: the counters of the threads alive, and the sum of those of the threads that have exited
+  struct Registry
+  {
+    mutex registry_mutex;
+    vector<vector<Sched_Profiler::Counters>*> threads;
+    vector<Sched_Profiler::Counters> exited = vector<Sched_Profiler::Counters>(n_sections);
+  };
+
+  Registry& GetRegistry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  void Add(vector<Sched_Profiler::Counters>& totals, const vector<Sched_Profiler::Counters>& counters)
+  {
+    unsigned i;
+
+    for (i = 0; i < n_sections; i++)
+    {
+      totals[i].calls += counters[i].calls;
+      totals[i].rejections += counters[i].rejections;
+      totals[i].total_ns += counters[i].total_ns;
+      totals[i].self_ns += counters[i].self_ns;
+    }
+  }
+
+  // Help struct: the counters of a thread, registered at its first profiled call
+  struct ThreadCounters
+  {
+    vector<Sched_Profiler::Counters> counters = vector<Sched_Profiler::Counters>(n_sections);
+
+    ThreadCounters()
+    {
+      lock_guard<mutex> lock(GetRegistry().registry_mutex);
+      GetRegistry().threads.push_back(&counters);
+    }
+    ~ThreadCounters()
+    {
+      lock_guard<mutex> lock(GetRegistry().registry_mutex);
+      Add(GetRegistry().exited, counters);
+      GetRegistry().threads.erase(find(GetRegistry().threads.begin(), GetRegistry().threads.end(), &counters));
+    }
+  };
+}
+
+/***************************************************************************
+ * Profiler Code
+ ***************************************************************************/
+
+Sched_Profiler::Counters& Sched_Profiler::Local(Explorer e, Operation o)
+{
+  thread_local ThreadCounters thread_counters;
+
+  return thread_counters.counters[(unsigned)e * N_OPERATIONS + o];
+}
+
+// NOTE: the counters of the other threads are read without synchronization, so this is meant for the end of
+// the run (when the workers are idle)
+vector<Sched_Profiler::Counters> Sched_Profiler::Totals()
+{
+  lock_guard<mutex> lock(GetRegistry().registry_mutex);
+  vector<Counters> totals = GetRegistry().exited;
+
+  for (const vector<Counters>* counters : GetRegistry().threads)
+    Add(totals, *counters);
+
+  return totals;
+}
+
+void Sched_Profiler::Reset()
+{
+  lock_guard<mutex> lock(GetRegistry().registry_mutex);
+
+  GetRegistry().exited.assign(n_sections, Counters());
+  for (vector<Counters>* counters : GetRegistry().threads)
+    counters->assign(n_sections, Counters());
+}
+
+string Sched_Profiler::SectionName(unsigned section)
+{
+  return string(explorer_names[section / N_OPERATIONS]) + "::" + operation_names[section % N_OPERATIONS];
+}
+
+void Sched_Profiler::PrintReport(ostream& os)
+{
+  vector<Counters> totals = Totals();
+  uint64_t total_ns = 0;
+  unsigned i;
+  ios_base::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+
+  for (i = 0; i < n_sections; i++)
+    total_ns += totals[i].self_ns;
+
+  os << "Section\tCalls\tRejected (%)\tMean (ns)\tSelf time (%)" << endl;
+  for (i = 0; i < n_sections; i++)
+  {
+    if (totals[i].calls == 0)
+      continue;
+
+    os << SectionName(i) << "\t" << totals[i].calls << "\t";
+    if (i % N_OPERATIONS == FEASIBLE_MOVE)
+      os << fixed << setprecision(2) << 100.0 * totals[i].rejections / totals[i].calls;
+    else
+      os << "-";
+    os << "\t" << fixed << setprecision(1) << double(totals[i].total_ns) / totals[i].calls
+       << "\t" << setprecision(2) << (total_ns > 0 ? 100.0 * totals[i].self_ns / total_ns : 0.0) << endl;
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void Sched_Profiler::WriteJSON(ostream& os)
+{
+  vector<Counters> totals = Totals();
+  uint64_t total_ns = 0;
+  unsigned i;
+  ios_base::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  bool first = true;
+
+  for (i = 0; i < n_sections; i++)
+    total_ns += totals[i].self_ns;
+
+  os << defaultfloat << setprecision(6) << "{" << endl << "  \"self_time_ns\": " << total_ns << "," << endl << "  \"sections\": [";
+  for (i = 0; i < n_sections; i++)
+  {
+    if (totals[i].calls == 0)
+      continue;
+
+    os << (first ? "" : ",") << endl
+       << "    {\"explorer\": \"" << explorer_names[i / N_OPERATIONS] << "\", \"operation\": \"" << operation_names[i % N_OPERATIONS]
+       << "\", \"calls\": " << totals[i].calls << ", \"rejections\": " << totals[i].rejections
+       << ", \"total_ns\": " << totals[i].total_ns << ", \"self_ns\": " << totals[i].self_ns
+       << ", \"mean_ns\": " << double(totals[i].total_ns) / totals[i].calls
+       << ", \"self_share\": " << (total_ns > 0 ? double(totals[i].self_ns) / total_ns : 0.0) << "}";
+    first = false;
+  }
+  os << endl << "  ]" << endl << "}" << endl;
+  os.flags(flags);
+  os.precision(precision);
+}
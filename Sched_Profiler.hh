@@ -0,0 +1,96 @@
+// File Sched_Profiler.hh
+#ifndef SCHED_PROFILER_HH
+#define SCHED_PROFILER_HH
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Instrumentation of the hot paths (explorers, fused delta cost and full cost components), compiled in only with
+// -DSCHED_PROFILING (make PROFILE=1): each profiled function counts its calls, its inclusive time and its self time
+// (without the profiled functions it calls) in thread-local counters, merged at the end of the run
+class Sched_Profiler
+{
+public:
+  enum Explorer { SWAP_HOURS, ASSIGN_PROF, SWAP_PROF, CROSS_SWAP_HOURS, KEMPE_CHAIN, COST_FUNCTION, N_EXPLORERS };
+  enum Operation { RANDOM_MOVE, FEASIBLE_MOVE, MAKE_MOVE, FIRST_MOVE, NEXT_MOVE, FIRST_MOVE_IN_BLOCK, NEXT_MOVE_IN_BLOCK, FUSED_DELTAS,
+                   PROF_UNAVAILABILITY, MAX_SUBJECT_HOURS_X_DAY, PROF_MAX_WEEKLY_HOURS, SCHEDULE_CONTIGUITY, SOLUTION_COMPLETE, N_OPERATIONS };
+
+  struct Counters
+  {
+    uint64_t calls = 0;
+    uint64_t rejections = 0;  // FeasibleMove calls that returned false
+    uint64_t total_ns = 0;
+    uint64_t self_ns = 0;
+  };
+
+  static constexpr bool Enabled()
+  {
+#ifdef SCHED_PROFILING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  static Counters& Local(Explorer e, Operation o);   // counters of the calling thread
+  static vector<Counters> Totals();                   // all the threads, indexed by e * N_OPERATIONS + o
+  static void Reset();
+  static string SectionName(unsigned section);
+
+  // Call counts, FeasibleMove rejection rates, mean ns per call and share of the total (self) time
+  static void PrintReport(ostream& os);
+  static void WriteJSON(ostream& os);
+};
+
+// Times the enclosing scope; the time of the nested profiled scopes is subtracted from its self time
+class Sched_ProfileScope
+{
+public:
+  Sched_ProfileScope(Sched_Profiler::Explorer e, Sched_Profiler::Operation o)
+    : counters(Sched_Profiler::Local(e, o)), parent_child_ns(current_child_ns), child_ns(0), start(chrono::steady_clock::now())
+  {
+    current_child_ns = &child_ns;
+  }
+  ~Sched_ProfileScope()
+  {
+    uint64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    counters.calls++;
+    counters.total_ns += elapsed;
+    counters.self_ns += elapsed - min(elapsed, child_ns);
+    current_child_ns = parent_child_ns;
+    if (parent_child_ns != nullptr)
+      *parent_child_ns += elapsed;
+  }
+  bool Result(bool feasible)
+  {
+    if (!feasible)
+      counters.rejections++;
+    return feasible;
+  }
+private:
+  Sched_Profiler::Counters& counters;
+  uint64_t* parent_child_ns;
+  uint64_t child_ns;
+  chrono::steady_clock::time_point start;
+
+  static thread_local uint64_t* current_child_ns;  // child time of the innermost open scope of the thread
+};
+
+#ifdef SCHED_PROFILING
+#define SCHED_PROFILE(explorer, operation) Sched_ProfileScope sched_profile_scope(Sched_Profiler::explorer, Sched_Profiler::operation)
+#define SCHED_PROFILE_AS(explorer_value, operation) Sched_ProfileScope sched_profile_scope(explorer_value, Sched_Profiler::operation)
+#define SCHED_PROFILE_RETURN(feasible) return sched_profile_scope.Result(feasible)
+#else
+#define SCHED_PROFILE(explorer, operation)
+#define SCHED_PROFILE_AS(explorer_value, operation)
+#define SCHED_PROFILE_RETURN(feasible) return (feasible)
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+// File Sched_Runners.cc
+#include "Sched_Headers.hh"
+#include <sstream>
+
+namespace
+{
+  // Help functions: a move of the union as text, the index of its active neighborhood followed by the move
+  template <class Move>
+  bool WriteActiveMove(ostream& os, unsigned i, const ActiveMove<Move>& mv)
+  {
+    if (mv.active)
+      os << i << " " << static_cast<const Move&>(mv);
+    return mv.active;
+  }
+
+  string UnionMoveText(const Sched_UnionMove& mv)
+  {
+    ostringstream os;
+
+    WriteActiveMove(os, 0, get<0>(mv)) || WriteActiveMove(os, 1, get<1>(mv)) || WriteActiveMove(os, 2, get<2>(mv))
+      || WriteActiveMove(os, 3, get<3>(mv)) || WriteActiveMove(os, 4, get<4>(mv));
+    return os.str();
+  }
+
+  template <class Move>
+  void ReadActiveMove(istream& is, ActiveMove<Move>& mv)
+  {
+    is >> static_cast<Move&>(mv);
+    mv.active = !is.fail();
+  }
+
+  // False if the text is not a move
+  bool ReadUnionMove(const string& text, Sched_UnionMove& mv)
+  {
+    istringstream is(text);
+    unsigned i;
+
+    get<0>(mv).active = false;
+    get<1>(mv).active = false;
+    get<2>(mv).active = false;
+    get<3>(mv).active = false;
+    get<4>(mv).active = false;
+    if (!(is >> i))
+      return false;
+
+    switch (i)
+    {
+      case 0: ReadActiveMove(is, get<0>(mv)); break;
+      case 1: ReadActiveMove(is, get<1>(mv)); break;
+      case 2: ReadActiveMove(is, get<2>(mv)); break;
+      case 3: ReadActiveMove(is, get<3>(mv)); break;
+      case 4: ReadActiveMove(is, get<4>(mv)); break;
+      default: return false;
+    }
+    return !is.fail();
+  }
+}
+
+/***************************************************************************
+ * Steepest Descent Code
+ ***************************************************************************/
+
+// The values are the total, the violations, the objective and the components of the delta
+bool Sched_SteepestDescent::ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const
+{
+  Sched_UnionMove mv;
+
+  return HasFields(checkpoint, 0, checkpoint.values.size()) && checkpoint.values.size() >= 3 && checkpoint.moves.size() == 1
+    && ReadUnionMove(checkpoint.moves[0], mv);
+}
+
+void Sched_SteepestDescent::SaveRunnerState(Sched_Checkpointer::Checkpoint& checkpoint) const
+{
+  checkpoint.moves.push_back(UnionMoveText(current_move.move));
+  checkpoint.values.push_back(current_move.cost.total);
+  checkpoint.values.push_back(current_move.cost.violations);
+  checkpoint.values.push_back(current_move.cost.objective);
+  checkpoint.values.insert(checkpoint.values.end(), current_move.cost.all_components.begin(), current_move.cost.all_components.end());
+}
+
+void Sched_SteepestDescent::RestoreRunnerState(const Sched_Checkpointer::Checkpoint& checkpoint)
+{
+  Sched_UnionMove mv;
+  vector<int> components(checkpoint.values.begin() + 3, checkpoint.values.end());
+
+  ReadUnionMove(checkpoint.moves[0], mv);
+  current_move = EvaluatedMove<Sched_UnionMove, DefaultCostStructure<int>>(mv, DefaultCostStructure<int>(checkpoint.values[0], checkpoint.values[1], checkpoint.values[2], components));
+}
+
+/***************************************************************************
+ * Simulated Annealing Code
+ ***************************************************************************/
+
+bool Sched_SimulatedAnnealing::ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const
+{
+  return HasFields(checkpoint, 2, 1) && checkpoint.moves.empty() && checkpoint.values[0] > 0;
+}
+
+void Sched_SimulatedAnnealing::SaveRunnerState(Sched_Checkpointer::Checkpoint& checkpoint) const
+{
+  checkpoint.counters.push_back(neighbors_sampled);
+  checkpoint.counters.push_back(neighbors_accepted);
+  checkpoint.values.push_back(temperature);
+}
+
+void Sched_SimulatedAnnealing::RestoreRunnerState(const Sched_Checkpointer::Checkpoint& checkpoint)
+{
+  neighbors_sampled = checkpoint.counters[3];
+  neighbors_accepted = checkpoint.counters[4];
+  temperature = checkpoint.values[0];
+}
+
+/***************************************************************************
+ * Tabu Search Code
+ ***************************************************************************/
+
+// The counters after the runner ones are the tenures of the moves, in the order of the list
+bool Sched_TabuSearch::ValidCheckpoint(const Sched_Checkpointer::Checkpoint& checkpoint) const
+{
+  Sched_UnionMove mv;
+  unsigned i;
+
+  if (!HasFields(checkpoint, checkpoint.moves.size(), 0))
+    return false;
+  for (i = 0; i < checkpoint.moves.size(); i++)
+    if (!ReadUnionMove(checkpoint.moves[i], mv))
+      return false;
+  return true;
+}
+
+void Sched_TabuSearch::SaveRunnerState(Sched_Checkpointer::Checkpoint& checkpoint) const
+{
+  for (const TabuListItem<Sched_Output, Sched_UnionMove, DefaultCostStructure<int>>& item : tabu_list)
+  {
+    checkpoint.moves.push_back(UnionMoveText(item.move));
+    checkpoint.counters.push_back(item.tenure);
+  }
+}
+
+void Sched_TabuSearch::RestoreRunnerState(const Sched_Checkpointer::Checkpoint& checkpoint)
+{
+  Sched_UnionMove mv;
+  unsigned i;
+
+  tabu_list.clear();
+  for (i = 0; i < checkpoint.moves.size(); i++)
+  {
+    ReadUnionMove(checkpoint.moves[i], mv);
+    tabu_list.emplace_back(mv, checkpoint.counters[3 + i]);
+  }
+}
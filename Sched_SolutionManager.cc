@@ -5,7 +5,8 @@ namespace
 {
   // Greedy help function
   // Creates a list of randomly chosen possibile compatible hours for a professor checking free hours in professor and class schedule, 
-  // taking in account maximum hours per day and, optionally, hours not compatible with professor day off.
+  // taking in account maximum hours per day (including the hours of the subject already assigned to the class) and, optionally,
+  // hours not compatible with professor day off.
   vector<pair<unsigned, unsigned>> find_randomized_day_ordered_compatible_hours(const Sched_Input& in, Sched_Output& out, unsigned c, unsigned p, const unsigned& extra_daily_hours, const bool& check_unavailability_day)
   {
     unsigned d, h;
@@ -21,21 +22,21 @@ namespace
 
     for (d = 0; d < in.N_Days(); d++)
     {
-      hours_per_day = 0;
+      hours_per_day = out.DailySubjectAssignedHours(c, random_days[d], in.ProfSubject(p));
 
       for (h = 0; h < in.N_HoursXDay(); h++)
       {
         if ((check_unavailability_day) && in.ProfUnavailability(p) == random_days[d])
           break;
 
+        if (hours_per_day >= in.SubjectMaxHoursXDay() + extra_daily_hours)
+          break;
+
         if (out.Prof_Schedule(p, random_days[d], h) == -1 && out.Class_Schedule(c, random_days[d], h) == -1)
         {
           compatible_hours.push_back(pair<unsigned, unsigned>(random_days[d], h));
           hours_per_day++;
         }
-
-        if (hours_per_day >= in.SubjectMaxHoursXDay() + extra_daily_hours)
-          break;
       }
     }
     return compatible_hours;
@@ -171,6 +172,79 @@ void Sched_SolutionManager::GreedyState(Sched_Output& out)
     }
 }
 
+// Assigns the residual hours of all the classes (e.g., after some hours have been freed) with the logic of GreedyState:
+// the hours of a subject that has a professor in the class go to him, the others to the least loaded professor of the
+// subject with enough compatible hours. When no relaxation is left, the professor gets the compatible hours he has.
+void Sched_SolutionManager::RepairState(Sched_Output& out)
+{
+  unsigned s, i, p, residual_hours, extra_daily_hours;
+  bool prof_assigned, take_in_account_unavailability;
+  vector<unsigned> classes(in.N_Classes()), subjects_assignation_order(in.N_Subjects()), profs;
+  vector<pair<unsigned, unsigned>> compatible_hours;
+
+  // Classes in random order, subjects descending by weekly hours as in GreedyState
+  iota(classes.begin(), classes.end(), 0);
+  shuffle(classes.begin(), classes.end(), Random::GetGenerator());
+  iota(subjects_assignation_order.begin(), subjects_assignation_order.end(), 0);
+  sort(subjects_assignation_order.begin(), subjects_assignation_order.end(), [&](const unsigned& s1, const unsigned& s2) { return in.N_HoursXSubject(s1) > in.N_HoursXSubject(s2); });
+
+  for (const unsigned& c : classes)
+    for (s = 0; s < in.N_Subjects(); s++)
+    {
+      residual_hours = out.WeeklySubjectResidualHours(c, subjects_assignation_order[s]);
+      if (residual_hours == 0)
+        continue;
+
+      // The professor of the class, if any, otherwise the professors of the subject ascending by load
+      if (out.Subject_Prof(c, subjects_assignation_order[s]) != -1)
+        profs.assign(1, out.Subject_Prof(c, subjects_assignation_order[s]));
+      else
+      {
+        profs = in.GetSubjectProfsVector(subjects_assignation_order[s]);
+        shuffle(profs.begin(), profs.end(), Random::GetGenerator());
+        stable_sort(profs.begin(), profs.end(), [&](const unsigned a, const unsigned b) { return out.ProfWeeklyAssignedHours(a) < out.ProfWeeklyAssignedHours(b); });
+      }
+
+      prof_assigned = false;
+      extra_daily_hours = 0;
+      take_in_account_unavailability = true;
+
+      // Same relaxation of GreedyState
+      while (!prof_assigned && in.SubjectMaxHoursXDay() + extra_daily_hours <= in.N_HoursXDay())
+      {
+        for (p = 0; p < profs.size() && !prof_assigned; p++)
+        {
+          compatible_hours = find_randomized_day_ordered_compatible_hours(in, out, c, profs[p], extra_daily_hours, take_in_account_unavailability);
+
+          if (compatible_hours.size() >= residual_hours)
+          {
+            for (i = 0; i < residual_hours; i++)
+              out.AssignHour(c, compatible_hours[i].first, compatible_hours[i].second, profs[p]);
+
+            prof_assigned = true;
+          }
+        }
+
+        if (!prof_assigned)
+        {
+          if ((in.UnavailabilityViolationCost() < (extra_daily_hours + 1) * in.MaxSubjectHoursXDayViolationCost() || in.SubjectMaxHoursXDay() + extra_daily_hours == in.N_HoursXDay()) && take_in_account_unavailability)
+            take_in_account_unavailability = false;
+          else
+            extra_daily_hours++;
+        }
+      }
+
+      // No professor has enough compatible hours: the first one gets the hours he has (the rest stays unassigned)
+      if (!prof_assigned && !profs.empty())
+      {
+        compatible_hours = find_randomized_day_ordered_compatible_hours(in, out, c, profs[0], in.N_HoursXDay() - in.SubjectMaxHoursXDay(), false);
+
+        for (i = 0; i < residual_hours && i < compatible_hours.size(); i++)
+          out.AssignHour(c, compatible_hours[i].first, compatible_hours[i].second, profs[0]);
+      }
+    }
+}
+
 bool Sched_SolutionManager::CheckConsistency(const Sched_Output& out) const
 {
   unsigned c, s, d, h;
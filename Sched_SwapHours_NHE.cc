@@ -1,6 +1,62 @@
 // File Sched_SwapHours_NHE.cc
 #include "Sched_Headers.hh"
 
+namespace
+{
+  // Help function: hours of class c involved in a violation (a contiguity gap or an excess of daily hours of their subject,
+  //                or the unavailability day of a prof that did not get it as day off)
+  uint64_t ViolationSlots(const Sched_Input& in, const Sched_Output& out, unsigned c)
+  {
+    unsigned s, d;
+    int p;
+    uint64_t subject_hours, day_hours, slots = 0;
+
+    for (s = 0; s < in.N_Subjects(); s++)
+    {
+      subject_hours = out.ClassSubjectMask(c, s);
+      if (subject_hours == 0)
+        continue;
+
+      for (d = 0; d < in.N_Days(); d++)
+      {
+        day_hours = out.ClassSubjectDayMask(c, d, s);
+        if (Sched_Output::ContiguityGaps(day_hours) > 0 || (unsigned)popcount(day_hours) > in.SubjectMaxHoursXDay())
+          slots |= day_hours << (d * in.N_HoursXDay());
+      }
+
+      p = out.Subject_Prof(c, s);
+      if (out.ProfAssignedDayOff(p) != (int)in.ProfUnavailability(p))
+        slots |= subject_hours & (out.DayMask() << (in.ProfUnavailability(p) * in.N_HoursXDay()));
+    }
+
+    return slots;
+  }
+
+  // Help function: hours of class c that can be swapped with the hour slot_1 (the new hour of each prof must be free)
+  uint64_t SecondHourCandidates(const Sched_Input& in, const Sched_Output& out, unsigned c, unsigned slot_1)
+  {
+    unsigned s;
+    int p, prof_1 = out.Class_Schedule(c, slot_1 / in.N_HoursXDay(), slot_1 % in.N_HoursXDay());
+    uint64_t candidates;
+
+    // A busy hour goes where its prof is free (this also excludes its own hours), a free one needs a busy partner
+    if (prof_1 != -1)
+      candidates = out.WeekMask() & ~out.ProfMask(prof_1);
+    else
+      candidates = out.ClassMask(c);
+
+    // The hours of the profs that are busy at slot_1 cannot move there
+    for (s = 0; s < in.N_Subjects(); s++)
+    {
+      p = out.Subject_Prof(c, s);
+      if (p != -1 && p != prof_1 && (out.ProfMask(p) >> slot_1 & 1))
+        candidates &= ~out.ClassSubjectMask(c, s);
+    }
+
+    return candidates;
+  }
+}
+
 /***************************************************************************
  * Moves Code
  ***************************************************************************/
@@ -57,54 +113,74 @@ ostream& operator<<(ostream& os, const Sched_SwapHours& mv)
 
 void Sched_SwapHours_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sched_SwapHours& mv) const
 {
-  unsigned max_iterations = 1000000;
+  SCHED_PROFILE(SWAP_HOURS, RANDOM_MOVE);
+
+  unsigned max_iterations = 10 * in.N_Classes() * in.N_Days() * in.N_HoursXDay();
   unsigned iterations = 0;
+  uint64_t violation_slots, candidates;
+  unsigned slot_1, slot_2;
 
+  // The second hour is drawn among the feasible ones (given class and first hour), so only the draws whose first
+  // hour has no feasible partner are repeated
   do
   {
-    mv._class = Random::Uniform<int>(0, in.N_Classes()-1);
-
-    mv.day_1 = Random::Uniform<int>(0, in.N_Days()-1);
-    mv.hour_1 = Random::Uniform<int>(0, in.N_HoursXDay()-1);
-
-    mv.day_2 = Random::Uniform<int>(0, in.N_Days()-1);
-    mv.hour_2 = Random::Uniform<int>(0, in.N_HoursXDay()-1);
-
     iterations++;
     if (iterations > max_iterations)
       throw EmptyNeighborhood();
 
-  } while (!FeasibleMove(out, mv));
+    mv._class = Sched_Random::Uniform<int>(0, in.N_Classes()-1);
+
+    violation_slots = violation_bias > 0 ? ViolationSlots(in, out, mv._class) : 0;
+    if (violation_slots != 0 && Sched_Random::Uniform<double>(0.0, 1.0) < violation_bias)
+      slot_1 = Sched_Output::NthHour(violation_slots, Sched_Random::Uniform<unsigned>(0, popcount(violation_slots)-1));
+    else
+      slot_1 = Sched_Random::Uniform<unsigned>(0, in.N_Days() * in.N_HoursXDay() - 1);
+
+    candidates = SecondHourCandidates(in, out, mv._class, slot_1);
+  } while (candidates == 0);
+
+  slot_2 = Sched_Output::NthHour(candidates, Sched_Random::Uniform<unsigned>(0, popcount(candidates)-1));
+
+  mv.day_1 = slot_1 / in.N_HoursXDay();
+  mv.hour_1 = slot_1 % in.N_HoursXDay();
+  mv.day_2 = slot_2 / in.N_HoursXDay();
+  mv.hour_2 = slot_2 % in.N_HoursXDay();
 } 
 
 bool Sched_SwapHours_NeighborhoodExplorer::FeasibleMove(const Sched_Output& out, const Sched_SwapHours& mv) const
 {
+  SCHED_PROFILE(SWAP_HOURS, FEASIBLE_MOVE);
+
   int prof_1 = out.Class_Schedule(mv._class, mv.day_1, mv.hour_1);
   int prof_2 = out.Class_Schedule(mv._class, mv.day_2, mv.hour_2);
 
   // If the prof is the same (either the case that both are -1)
   if (prof_1 == prof_2)
-    return false;
+    SCHED_PROFILE_RETURN(false);
 
   // If there is only one class the move is always feasible
   if (in.N_Classes() == 1)
-    return true;
+    SCHED_PROFILE_RETURN(true);
 
   // If at least one of the profs has their "new" hour already assigned
   if ((prof_1 != -1 && !out.IsProfHourFree(prof_1, mv.day_2, mv.hour_2)) 
    || (prof_2 != -1 && !out.IsProfHourFree(prof_2, mv.day_1, mv.hour_1)))
-    return false;
+    SCHED_PROFILE_RETURN(false);
 
-  return mv.day_1 != mv.day_2 || mv.hour_1 != mv.hour_2;
+  SCHED_PROFILE_RETURN(mv.day_1 != mv.day_2 || mv.hour_1 != mv.hour_2);
 } 
 
 void Sched_SwapHours_NeighborhoodExplorer::MakeMove(Sched_Output& out, const Sched_SwapHours& mv) const
 {
+    SCHED_PROFILE(SWAP_HOURS, MAKE_MOVE);
+
     out.SwapHours(mv._class, mv.day_1, mv.hour_1, mv._class, mv.day_2, mv.hour_2);
 }  
 
 void Sched_SwapHours_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sched_SwapHours& mv) const
 {
+  SCHED_PROFILE(SWAP_HOURS, FIRST_MOVE);
+
   mv._class = 0;
 
   mv.day_1 = 0;
@@ -120,6 +196,8 @@ void Sched_SwapHours_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sc
 
 bool Sched_SwapHours_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sched_SwapHours& mv) const
 {
+  SCHED_PROFILE(SWAP_HOURS, NEXT_MOVE);
+
   do
   {
     if (!AnyNextMove(out,mv))
@@ -130,6 +208,41 @@ bool Sched_SwapHours_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sch
   return true;
 }
 
+bool Sched_SwapHours_NeighborhoodExplorer::FirstMoveInBlock(const Sched_Output& out, Sched_SwapHours& mv, unsigned b) const
+{
+  SCHED_PROFILE(SWAP_HOURS, FIRST_MOVE_IN_BLOCK);
+
+  mv._class = b;
+
+  mv.day_1 = 0;
+  mv.hour_1 = 0;
+
+  mv.day_2 = 0;
+  mv.hour_2 = 1;
+
+  while (!FeasibleMove(out, mv))
+    if (!AnyNextMove(out, mv) || mv._class != (int)b)
+      return false;
+
+  return true;
+}
+
+bool Sched_SwapHours_NeighborhoodExplorer::NextMoveInBlock(const Sched_Output& out, Sched_SwapHours& mv) const
+{
+  SCHED_PROFILE(SWAP_HOURS, NEXT_MOVE_IN_BLOCK);
+
+  int b = mv._class;
+
+  do
+  {
+    if (!AnyNextMove(out, mv) || mv._class != b)
+      return false;
+  }
+  while (!FeasibleMove(out, mv));
+
+  return true;
+}
+
 bool Sched_SwapHours_NeighborhoodExplorer::AnyNextMove(const Sched_Output& out, Sched_SwapHours& mv) const
 {
   // Condition that determines the end of scanning the schedule of a class: there is no next move after swapping the last two time slots.
@@ -52,6 +52,8 @@ ostream& operator<<(ostream& os, const Sched_SwapProf& mv)
 
 void Sched_SwapProf_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sched_SwapProf& mv) const
 {
+  SCHED_PROFILE(SWAP_PROF, RANDOM_MOVE);
+
   unsigned max_iterations = 1000000;
   unsigned iterations = 0;
 
@@ -60,10 +62,10 @@ void Sched_SwapProf_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sc
 
   do
   {
-    mv.subject = Random::Uniform<int>(0, in.N_Subjects() - 1);
+    mv.subject = Sched_Random::Uniform<int>(0, in.N_Subjects() - 1);
 
-    mv.class_1 = Random::Uniform<int>(0, in.N_Classes() - 1);
-    mv.class_2 = Random::Uniform<int>(0, in.N_Classes() - 1);
+    mv.class_1 = Sched_Random::Uniform<int>(0, in.N_Classes() - 1);
+    mv.class_2 = Sched_Random::Uniform<int>(0, in.N_Classes() - 1);
 
     iterations++;
     if (iterations > max_iterations)
@@ -74,76 +76,45 @@ void Sched_SwapProf_NeighborhoodExplorer::RandomMove(const Sched_Output& out, Sc
 
 bool Sched_SwapProf_NeighborhoodExplorer::FeasibleMove(const Sched_Output& out, const Sched_SwapProf& mv) const
 {
-  unsigned d, h;
+  SCHED_PROFILE(SWAP_PROF, FEASIBLE_MOVE);
+
+  int prof_1, prof_2;
 
   if (mv.class_1 == mv.class_2)
-    return false;
+    SCHED_PROFILE_RETURN(false);
+
+  prof_1 = out.Subject_Prof(mv.class_1, mv.subject);
+  prof_2 = out.Subject_Prof(mv.class_2, mv.subject);
 
   // If a class doesn't have an assigned professor for that class the move is not valid (there is no swap)
-  if (out.Subject_Prof(mv.class_1, mv.subject) == -1 || out.Subject_Prof(mv.class_2, mv.subject) == -1)
-    return false;
+  if (prof_1 == -1 || prof_2 == -1)
+    SCHED_PROFILE_RETURN(false);
 
   // If the two classes have the same professor for that subject, the swap does not make sense
-  if (out.Subject_Prof(mv.class_1, mv.subject) == out.Subject_Prof(mv.class_2, mv.subject))
-    return false;
+  if (prof_1 == prof_2)
+    SCHED_PROFILE_RETURN(false);
 
-  // Check time incompatibility
-  for (d = 0; d < in.N_Days(); d++)
-    for (h = 0; h < in.N_HoursXDay(); h++)
-    {
-      // The professor is not busy in class 1 and the hour is not a free hour for the professor:
-      // the professor is thus busy with a third class not involved in the swap.
-      if (out.Prof_Schedule(out.Subject_Prof(mv.class_2, mv.subject), d, h) == mv.class_2 
-       && !(out.Prof_Schedule(out.Subject_Prof(mv.class_1, mv.subject), d, h) == mv.class_1 
-          || out.IsProfHourFree(out.Subject_Prof(mv.class_1, mv.subject), d, h)))
-        return false;
-
-      if (out.Prof_Schedule(out.Subject_Prof(mv.class_1, mv.subject), d, h) == mv.class_1 
-       && !(out.Prof_Schedule(out.Subject_Prof(mv.class_2, mv.subject), d, h) == mv.class_2 
-          || out.IsProfHourFree(out.Subject_Prof(mv.class_2, mv.subject), d, h)))
-        return false;
-    }
+  // Check time incompatibility on the whole week: a professor is busy with a third class not involved
+  // in the swap in one of the hours he should take over
+  // (hours of prof_1 outside class 1) AND (hours of prof_2 in class 2), and vice versa
+  if ((out.ProfMask(prof_1) & ~out.ClassSubjectMask(mv.class_1, mv.subject) & out.ClassSubjectMask(mv.class_2, mv.subject)) != 0
+   || (out.ProfMask(prof_2) & ~out.ClassSubjectMask(mv.class_2, mv.subject) & out.ClassSubjectMask(mv.class_1, mv.subject)) != 0)
+    SCHED_PROFILE_RETURN(false);
 
-  return true;
+  SCHED_PROFILE_RETURN(true);
 }
 
 void Sched_SwapProf_NeighborhoodExplorer::MakeMove(Sched_Output& out, const Sched_SwapProf& mv) const
 {
-  unsigned d, h, i;
+  SCHED_PROFILE(SWAP_PROF, MAKE_MOVE);
 
-  int prof_1;
-  int prof_2;
-  vector<pair<unsigned, unsigned>> hours_prof_1(0);
-  vector<pair<unsigned, unsigned>> hours_prof_2(0);
-
-  prof_1 = out.Subject_Prof(mv.class_1, mv.subject);
-  prof_2 = out.Subject_Prof(mv.class_2, mv.subject);
-
-  for (d = 0; d < in.N_Days(); d++)
-    for (h = 0; h < in.N_HoursXDay(); h++)
-    {
-      if (out.Class_Schedule(mv.class_1, d, h) == prof_1)
-      {
-        hours_prof_1.push_back(pair<unsigned, unsigned>(d, h));
-        out.FreeHour(mv.class_1, d, h);
-      }
-
-      if (out.Class_Schedule(mv.class_2, d, h) == prof_2)
-      {
-        hours_prof_2.push_back(pair<unsigned, unsigned>(d, h));
-        out.FreeHour(mv.class_2, d, h);
-      }
-    }
-
-  for (i = 0; i < hours_prof_1.size(); i++)
-    out.AssignHour(mv.class_1, hours_prof_1[i].first, hours_prof_1[i].second, prof_2);
-
-  for (i = 0; i < hours_prof_2.size(); i++)
-    out.AssignHour(mv.class_2, hours_prof_2[i].first, hours_prof_2[i].second, prof_1);
+  out.SwapSubjectProfs(mv.class_1, mv.class_2, mv.subject);
 }
 
 void Sched_SwapProf_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sched_SwapProf& mv) const
 {
+  SCHED_PROFILE(SWAP_PROF, FIRST_MOVE);
+
   if (in.N_Profs() == in.N_Subjects())  // There is only one professor for each subject => no swap exists
     throw EmptyNeighborhood();
 
@@ -160,6 +131,8 @@ void Sched_SwapProf_NeighborhoodExplorer::FirstMove(const Sched_Output& out, Sch
 
 bool Sched_SwapProf_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sched_SwapProf& mv) const
 {
+  SCHED_PROFILE(SWAP_PROF, NEXT_MOVE);
+
   do
   {
     if (!AnyNextMove(out, mv))
@@ -169,8 +142,47 @@ bool Sched_SwapProf_NeighborhoodExplorer::NextMove(const Sched_Output& out, Sche
   return true;
 }
 
+bool Sched_SwapProf_NeighborhoodExplorer::FirstMoveInBlock(const Sched_Output& out, Sched_SwapProf& mv, unsigned b) const
+{
+  SCHED_PROFILE(SWAP_PROF, FIRST_MOVE_IN_BLOCK);
+
+  if (in.N_Classes() < 2)  // There is only one class => no swap exists
+    return false;
+
+  mv.subject = b;
+  mv.class_1 = 0;
+  mv.class_2 = 1;
+
+  while (!FeasibleMove(out, mv))
+  {
+    if (!AnyNextMove(out, mv) || mv.subject != (int)b)
+      return false;
+  }
+
+  return true;
+}
+
+bool Sched_SwapProf_NeighborhoodExplorer::NextMoveInBlock(const Sched_Output& out, Sched_SwapProf& mv) const
+{
+  SCHED_PROFILE(SWAP_PROF, NEXT_MOVE_IN_BLOCK);
+
+  int b = mv.subject;
+
+  do
+  {
+    if (!AnyNextMove(out, mv) || mv.subject != b)
+      return false;
+  } while (!FeasibleMove(out, mv));
+
+  return true;
+}
+
 bool Sched_SwapProf_NeighborhoodExplorer::AnyNextMove(const Sched_Output& out, Sched_SwapProf& mv) const
 {
+  // Pruning: if class 1 has no professor for the subject, none of its pairs is feasible => go to the next class 1
+  if (out.Subject_Prof(mv.class_1, mv.subject) == -1)
+    mv.class_2 = in.N_Classes() - 1;
+
   // Last possible swap between two classes (for the same subject)
   if (mv.class_1 >= in.N_Classes() - 2 && mv.class_2 >= in.N_Classes() - 1)
   {
@@ -0,0 +1,111 @@
+// File Sched_ThreadPool.cc
+#include "Sched_ThreadPool.hh"
+
+Sched_ThreadPool::Sched_ThreadPool(unsigned n_threads)
+  : current_job(nullptr),
+    current_n_jobs(0),
+    next_job(0),
+    running_workers(0),
+    generation(0),
+    stopping(false)
+{
+  unsigned i;
+
+  for (i = 1; i < n_threads; i++)
+    workers.emplace_back(&Sched_ThreadPool::WorkerLoop, this);
+}
+
+Sched_ThreadPool::~Sched_ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(pool_mutex);
+    stopping = true;
+  }
+  start_condition.notify_all();
+
+  for (thread& t : workers)
+    t.join();
+}
+
+void Sched_ThreadPool::ParallelFor(unsigned n_jobs, const function<void(unsigned)>& job)
+{
+  exception_ptr e;
+
+  if (workers.empty() || n_jobs <= 1)
+  {
+    for (unsigned i = 0; i < n_jobs; i++)
+      job(i);
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(pool_mutex);
+    current_job = &job;
+    current_n_jobs = n_jobs;
+    next_job = 0;
+    running_workers = workers.size();
+    job_exception = nullptr;
+    generation++;
+  }
+  start_condition.notify_all();
+
+  // The calling thread works as well
+  RunJobs();
+
+  unique_lock<mutex> lock(pool_mutex);
+  done_condition.wait(lock, [this]() { return running_workers == 0; });
+  current_job = nullptr;
+
+  if (job_exception)
+  {
+    e = job_exception;
+    job_exception = nullptr;
+    rethrow_exception(e);
+  }
+}
+
+void Sched_ThreadPool::WorkerLoop()
+{
+  unsigned long seen_generation = 0;
+
+  while (true)
+  {
+    {
+      unique_lock<mutex> lock(pool_mutex);
+      start_condition.wait(lock, [&]() { return stopping || generation != seen_generation; });
+
+      if (stopping)
+        return;
+
+      seen_generation = generation;
+    }
+
+    RunJobs();
+
+    {
+      lock_guard<mutex> lock(pool_mutex);
+      running_workers--;
+    }
+    done_condition.notify_one();
+  }
+}
+
+// Takes jobs from the shared counter until the loop is exhausted
+void Sched_ThreadPool::RunJobs()
+{
+  unsigned i;
+
+  while ((i = next_job++) < current_n_jobs)
+  {
+    try
+    {
+      (*current_job)(i);
+    }
+    catch (...)
+    {
+      lock_guard<mutex> lock(pool_mutex);
+      if (!job_exception)
+        job_exception = current_exception();
+    }
+  }
+}
@@ -0,0 +1,50 @@
+// File Sched_ThreadPool.hh
+#ifndef SCHED_THREADPOOL_HH
+#define SCHED_THREADPOOL_HH
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+using namespace std;
+
+// Fixed set of worker threads that run the iterations of a parallel loop.
+// The calling thread takes part in the loop, so a pool of n threads starts n - 1 workers.
+// NOTE: ParallelFor calls cannot be nested and must be issued by one thread at a time
+class Sched_ThreadPool
+{
+public:
+  // Constructor and destructor
+  Sched_ThreadPool(unsigned n_threads);
+  ~Sched_ThreadPool();
+
+  unsigned N_Threads() const { return workers.size() + 1; }
+
+  // Runs job(i) for each i in [0, n_jobs) and returns when all of them are done.
+  // The first exception thrown by a job is rethrown to the caller.
+  void ParallelFor(unsigned n_jobs, const function<void(unsigned)>& job);
+
+private:
+  void WorkerLoop();
+  void RunJobs();
+
+  vector<thread> workers;
+
+  mutex pool_mutex;
+  condition_variable start_condition;
+  condition_variable done_condition;
+
+  // Current loop (valid while running_workers > 0)
+  const function<void(unsigned)>* current_job;
+  unsigned current_n_jobs;
+  atomic<unsigned> next_job;
+  unsigned running_workers;
+  unsigned long generation;   // incremented each time a loop starts
+  bool stopping;
+  exception_ptr job_exception;
+};
+#endif
@@ -0,0 +1,185 @@
+// File Sched_TrajectoryLogger.cc
+#include "Sched_TrajectoryLogger.hh"
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+  // Help function: the ring capacity, a power of two so that positions map to slots with a mask
+  size_t RingCapacity(size_t capacity)
+  {
+    size_t c = 2;
+
+    while (c < capacity)
+      c *= 2;
+    return c;
+  }
+
+  template <typename T>
+  void WriteBinary(ofstream& os, T value)
+  {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  const char* event_names[4] = {"Start", "Improvement", "Sample", "End"};
+}
+
+Sched_TrajectoryLogger::Sched_TrajectoryLogger(const string& filename, bool binary, size_t capacity)
+  : os(filename, binary ? ios::binary : ios::out),
+    binary(binary),
+    n_components(0),
+    start(chrono::steady_clock::now()),
+    ring(RingCapacity(capacity)),
+    mask(ring.size() - 1),
+    enqueue_position(0),
+    dequeue_position(0),
+    stop(false),
+    written(0),
+    dropped(0)
+{
+  size_t i;
+
+  if (!os)
+    throw runtime_error("Cannot open trajectory file " + filename);
+
+  for (i = 0; i < ring.size(); i++)
+    ring[i].sequence.store(i, memory_order_relaxed);
+
+  writer = thread(&Sched_TrajectoryLogger::WriterLoop, this);
+}
+
+Sched_TrajectoryLogger::~Sched_TrajectoryLogger()
+{
+  Close();
+}
+
+void Sched_TrajectoryLogger::Close()
+{
+  if (writer.joinable())
+  {
+    stop = true;
+    writer.join();
+    os.close();
+  }
+}
+
+bool Sched_TrajectoryLogger::Log(EventKind kind, unsigned long move, int total, int violations, const vector<int>& components)
+{
+  Event e;
+  unsigned i;
+
+  e.time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  e.move = move;
+  e.total = total;
+  e.violations = violations;
+  e.kind = kind;
+  e.n_components = min<size_t>(components.size(), max_components);
+  for (i = 0; i < e.n_components; i++)
+    e.components[i] = components[i];
+
+  return Push(e);
+}
+
+// Bounded multi-producer queue: a producer claims a position with a CAS and publishes the slot through its
+// sequence number, so that the writer reads only filled slots
+bool Sched_TrajectoryLogger::Push(const Event& e)
+{
+  size_t position = enqueue_position.load(memory_order_relaxed);
+  size_t sequence;
+  Slot* slot;
+
+  for (;;)
+  {
+    slot = &ring[position & mask];
+    sequence = slot->sequence.load(memory_order_acquire);
+    if (sequence == position)
+    {
+      if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+        break;
+    }
+    else if (sequence < position)
+    { // the slot has not been written out since the previous round: the buffer is full
+      dropped.fetch_add(1, memory_order_relaxed);
+      return false;
+    }
+    else
+      position = enqueue_position.load(memory_order_relaxed);
+  }
+
+  slot->event = e;
+  slot->sequence.store(position + 1, memory_order_release);
+  return true;
+}
+
+bool Sched_TrajectoryLogger::Pop(Event& e)
+{
+  Slot& slot = ring[dequeue_position & mask];
+
+  if (slot.sequence.load(memory_order_acquire) != dequeue_position + 1)
+    return false;
+
+  e = slot.event;
+  slot.sequence.store(dequeue_position + ring.size(), memory_order_release);
+  dequeue_position++;
+  return true;
+}
+
+void Sched_TrajectoryLogger::WriterLoop()
+{
+  Event e;
+  bool stopping;
+
+  do
+  {
+    // stop is read before draining, so that the events pushed before Close are all written
+    stopping = stop;
+    while (Pop(e))
+      Write(e);
+    if (!stopping)
+      this_thread::sleep_for(chrono::milliseconds(1));
+  } while (!stopping);
+
+  os.flush();
+}
+
+void Sched_TrajectoryLogger::Write(const Event& e)
+{
+  unsigned i;
+
+  if (written == 0)
+  {
+    n_components = e.n_components;
+    if (binary)
+    {
+      os.write("SCHEDTRJ", 8);
+      WriteBinary<uint32_t>(os, binary_version);
+      WriteBinary<uint32_t>(os, n_components);
+    }
+    else
+    {
+      os << "event,time,move,total,violations";
+      for (i = 0; i < n_components; i++)
+        os << ",component" << i;
+      os << '\n';
+    }
+  }
+
+  if (binary)
+  {
+    WriteBinary<uint8_t>(os, e.kind);
+    WriteBinary<double>(os, e.time);
+    WriteBinary<uint64_t>(os, e.move);
+    WriteBinary<int32_t>(os, e.total);
+    WriteBinary<int32_t>(os, e.violations);
+    for (i = 0; i < n_components; i++)
+      WriteBinary<int32_t>(os, i < e.n_components ? e.components[i] : 0);
+  }
+  else
+  {
+    os << event_names[e.kind] << ',' << e.time << ',' << e.move << ',' << e.total << ',' << e.violations;
+    for (i = 0; i < n_components; i++)
+      os << ',' << (i < e.n_components ? e.components[i] : 0);
+    os << '\n';
+  }
+  written++;
+}
@@ -0,0 +1,74 @@
+// File Sched_TrajectoryLogger.hh
+#ifndef SCHED_TRAJECTORYLOGGER_HH
+#define SCHED_TRAJECTORYLOGGER_HH
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+// Asynchronous log of the cost trajectory of a run. The search thread pushes its events in a bounded lock-free
+// ring buffer (an event that does not fit is dropped and counted, the search never waits) and a writer thread
+// drains the buffer to the file, as CSV or as a compact binary stream:
+//   header:  "SCHEDTRJ", uint32 version, uint32 number of components
+//   records: uint8 kind, double time (s), uint64 move, int32 total, int32 violations, int32 components[]
+class Sched_TrajectoryLogger
+{
+public:
+  enum EventKind : uint8_t { START, IMPROVEMENT, SAMPLE, END };
+  static const unsigned max_components = 8;
+  static const uint32_t binary_version = 1;
+
+  struct Event
+  {
+    double time;
+    uint64_t move;
+    int32_t total;
+    int32_t violations;
+    uint8_t kind;
+    uint8_t n_components;
+    int32_t components[max_components];
+  };
+
+  Sched_TrajectoryLogger(const string& filename, bool binary, size_t capacity = 65536);
+  ~Sched_TrajectoryLogger();
+
+  // Timestamps the event from the construction of the logger and pushes it, false if the buffer is full
+  bool Log(EventKind kind, unsigned long move, int total, int violations, const vector<int>& components);
+  void Close();  // writes the pending events and stops the writer
+
+  unsigned long Written() const { return written; }
+  unsigned long Dropped() const { return dropped; }
+protected:
+  struct Slot
+  {
+    atomic<size_t> sequence;  // position the slot is free for (== position) or filled at (== position + 1)
+    Event event;
+  };
+
+  bool Push(const Event& e);
+  bool Pop(Event& e);
+  void WriterLoop();
+  void Write(const Event& e);
+
+  ofstream os;
+  bool binary;
+  unsigned n_components;   // fixed by the first event written
+  chrono::steady_clock::time_point start;
+
+  vector<Slot> ring;
+  size_t mask;
+  alignas(64) atomic<size_t> enqueue_position;
+  alignas(64) size_t dequeue_position;   // writer thread only
+
+  atomic<bool> stop;
+  thread writer;
+  atomic<unsigned long> written, dropped;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#! /usr/bin/env python3
+# Benchmark suite: runs every instance of Instances/ from its Greedy and Random initial states of InitStates/,
+# with each runner and several seeds, and writes the results as CSV and JSON (see 'make bench')
+import argparse
+import csv
+import glob
+import json
+import os
+import re
+import subprocess
+import tempfile
+from datetime import datetime
+
+# directory of the instances
+instance_directory = "./Instances"
+
+# directory of the initstates
+init_state_directory = "./InitStates"
+
+# RUNNER PARAMETERS (each run is also bounded by the solver timeout)
+runners = {
+  "HC": ["--HC::max_idle_iterations", "1000000"],
+  "SD": [],
+  "SA": ["--SA::start_temperature", "20", "--SA::min_temperature", "0.5", "--SA::cooling_rate", "0.99",
+         "--SA::neighbors_sampled", "10000", "--SA::neighbors_accepted", "10000"],
+  "TS": ["--TS::max_idle_iterations", "1000", "--TS::min_tenure", "5", "--TS::max_tenure", "10"]
+}
+
+fields = ["instance", "init_state", "method", "seed", "cost", "violations", "time", "moves", "delta_evaluations",
+          "moves_per_second", "delta_evaluations_per_second", "time_to_best"]
+
+
+def parse_arguments():
+  parser = argparse.ArgumentParser(description="Benchmark of the local search runners")
+  parser.add_argument("--executable", default="./csp")
+  parser.add_argument("--instances", nargs="*", help="instance names (e.g. 2 2_2 6), default all")
+  parser.add_argument("--methods", nargs="*", default=list(runners.keys()), choices=list(runners.keys()))
+  parser.add_argument("--init_states", nargs="*", default=["Greedy", "Random"], choices=["Greedy", "Random"])
+  parser.add_argument("--seeds", type=int, default=3, help="number of seeds per configuration")
+  parser.add_argument("--timeout", type=float, default=10, help="time limit of each run (s)")
+  parser.add_argument("--output", default="./Bench", help="directory of the results")
+  return parser.parse_args()
+
+
+def instance_names():
+  names = []
+  for path in glob.glob(instance_directory + "/instance*.txt"):
+    names.append(re.match(r"instance(.*)\.txt", os.path.basename(path)).group(1))
+  # numeric order: 2, 2_2, 2_3, 3, ...
+  return sorted(names, key=lambda n: [int(x) for x in n.split("_")])
+
+
+def solver_version():
+  try:
+    return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], text=True).strip()
+  except (OSError, subprocess.CalledProcessError):
+    return "unknown"
+
+
+# Runs csp and reads the statistics it writes in the output file ("Key:<tab>value" lines)
+def run(executable, instance, init_state, method, seed, timeout):
+  with tempfile.NamedTemporaryFile(suffix=".out", delete=False) as f:
+    output_file = f.name
+
+  command = [executable,
+             "--main::instance", instance_directory + "/instance" + instance + ".txt",
+             "--main::init_state", init_state_directory + "/" + init_state + instance,
+             "--main::method", method,
+             "--main::seed", str(seed),
+             "--main::statistics-enable",
+             "--main::output_file", output_file,
+             "--Sched_solver::timeout", str(timeout)] + runners[method]
+
+  try:
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+    values = {}
+    with open(output_file) as f:
+      for line in f:
+        key, _, value = line.partition(":")
+        if value:
+          values[key.strip()] = value.split()[0]
+  finally:
+    os.remove(output_file)
+
+  time = float(values["Time"])
+  moves = int(values["Moves"])
+  delta_evaluations = int(values["DeltaEvaluations"])
+  return {"instance": instance, "init_state": init_state, "method": method, "seed": seed,
+          "cost": int(values["Cost"]), "violations": int(values["Violations"]), "time": time,
+          "moves": moves, "delta_evaluations": delta_evaluations,
+          "moves_per_second": moves / time if time > 0 else 0.0,
+          "delta_evaluations_per_second": delta_evaluations / time if time > 0 else 0.0,
+          "time_to_best": float(values["TimeToBest"])}
+
+
+def main():
+  args = parse_arguments()
+  results = []
+
+  for instance in args.instances or instance_names():
+    for init_state in args.init_states:
+      if not os.path.isfile(init_state_directory + "/" + init_state + instance):
+        continue
+      for method in args.methods:
+        for seed in range(args.seeds):
+          print("instance" + instance + " " + init_state + " " + method + " seed " + str(seed), flush=True)
+          try:
+            results.append(run(args.executable, instance, init_state, method, seed, args.timeout))
+          except (subprocess.CalledProcessError, OSError, KeyError, ValueError) as e:
+            print("  run failed: " + str(e))
+
+  if not os.path.isdir(args.output):
+    os.mkdir(args.output)
+
+  version = solver_version()
+  name = args.output + "/bench-" + version + "-" + datetime.now().strftime("%Y%m%d-%H%M%S")
+
+  with open(name + ".csv", "w", newline="") as f:
+    writer = csv.DictWriter(f, fieldnames=fields)
+    writer.writeheader()
+    writer.writerows(results)
+
+  with open(name + ".json", "w") as f:
+    json.dump({"version": version, "timeout": args.timeout, "results": results}, f, indent=2)
+
+  print("Results written to " + name + ".csv and " + name + ".json")
+
+
+if __name__ == "__main__":
+  main()